@@ -0,0 +1,571 @@
+﻿#include <Sig/Sig.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Scans synthetic and real-code corpora by every pattern format and reports GB/s and ns per candidate (every position
+// that the pattern may start at before the match or the end of the buffer), optionally as JSON:
+//
+//   Bench [--sizes 4K,64K,1M,16M,256M] [--engines template,mask,subpattern,bitmask,one-line] [--corpus path]
+//         [--min-time ms] [--json path]
+//
+// The real-code corpus is the given file (the benchmark itself by default) repeated to the size of the buffer.
+// Sig::isa() is reported with the results, the SIG_ISA environment variable chooses the kernels to measure.
+namespace
+{
+    constexpr size_t k_lengths[]{ 8, 16, 32, 64 };
+    constexpr size_t k_maxLength = 64;
+
+    // Quarters of the pattern that are wildcards:
+    constexpr size_t k_densities[]{ 0, 1, 2 };
+
+    enum class Position
+    {
+        early,
+        late,
+        none
+    };
+
+    constexpr const char* k_positions[]{ "early", "late", "none" };
+
+    // Bytes of patterns are the same for all formats, so template patterns are built from them in compile-time:
+    constexpr unsigned char patternByte(const size_t index)
+    {
+        return static_cast<unsigned char>(((index + 1) * 0x9E3779B1u) >> 24);
+    }
+
+    // The first and the last bytes are always exact:
+    constexpr bool wildcard(const size_t index, const size_t length, const size_t density)
+    {
+        return (index != 0) && (index != (length - 1)) && (((index * 5 + 1) % 4) < density);
+    }
+
+    // Every 8th exact byte is compared by the meaningful bits of the subpattern:
+    constexpr bool masked(const size_t index, const size_t length, const size_t density)
+    {
+        return !wildcard(index, length, density) && ((index % 8) == 5);
+    }
+
+    constexpr unsigned char k_subpatternBits = 0x7F;
+
+    template <size_t length, size_t density, size_t index>
+    using Entry = std::conditional_t<wildcard(index, length, density), Sig::Byte<>, Sig::Byte<patternByte(index)>>;
+
+    template <size_t length, size_t density, size_t... indices>
+    const void* findTemplate(const unsigned char* const buf, const size_t size, std::index_sequence<indices...>)
+    {
+        return Sig::find<Entry<length, density, indices>...>(buf, size);
+    }
+
+    template <size_t length, size_t density>
+    const void* findTemplate(const unsigned char* const buf, const size_t size)
+    {
+        return findTemplate<length, density>(buf, size, std::make_index_sequence<length>{});
+    }
+
+    using Finder = const void* (*)(const unsigned char* buf, size_t size);
+
+    template <size_t length>
+    Finder templateFinder(const size_t density)
+    {
+        switch (density)
+        {
+        case 0:
+            return findTemplate<length, 0>;
+        case 1:
+            return findTemplate<length, 1>;
+        default:
+            return findTemplate<length, 2>;
+        }
+    }
+
+    Finder templateFinder(const size_t length, const size_t density)
+    {
+        switch (length)
+        {
+        case 8:
+            return templateFinder<8>(density);
+        case 16:
+            return templateFinder<16>(density);
+        case 32:
+            return templateFinder<32>(density);
+        default:
+            return templateFinder<64>(density);
+        }
+    }
+
+    // The pattern in all formats:
+    struct Pattern
+    {
+        size_t length;
+        size_t density;
+        Finder templated;
+        unsigned char bytes[k_maxLength];
+        unsigned char msk[k_maxLength];
+        char sig[k_maxLength];
+        char subsig[k_maxLength];
+        char mask[k_maxLength + 1];
+        char subpatternMask[k_maxLength + 1];
+        std::string line;
+
+        Pattern(const size_t patternLength, const size_t wildcards)
+            : length(patternLength)
+            , density(wildcards)
+            , templated(templateFinder(patternLength, wildcards))
+            , bytes()
+            , msk()
+            , sig()
+            , subsig()
+            , mask()
+            , subpatternMask()
+        {
+            static const char k_digits[] = "0123456789ABCDEF";
+            for (size_t i = 0; i < length; ++i)
+            {
+                const bool any = wildcard(i, length, density);
+                bytes[i] = patternByte(i);
+                msk[i] = any ? 0x00 : 0xFF;
+                sig[i] = static_cast<char>(bytes[i]);
+                subsig[i] = static_cast<char>(masked(i, length, density) ? k_subpatternBits : 0xFF);
+                mask[i] = any ? '?' : '.';
+                subpatternMask[i] = any ? '?' : (masked(i, length, density) ? 'm' : '.');
+
+                if (i)
+                {
+                    line.push_back(' ');
+                }
+
+                if (any)
+                {
+                    line.push_back('?');
+                }
+                else
+                {
+                    line.push_back(k_digits[bytes[i] >> 4]);
+                    line.push_back(k_digits[bytes[i] & 0xF]);
+                }
+            }
+        }
+    };
+
+    struct Engine
+    {
+        const char* name;
+        const void* (*find)(const unsigned char* buf, size_t size, const Pattern& pattern);
+    };
+
+    const Engine k_engines[]
+    {
+        {
+            "template",
+            [](const unsigned char* const buf, const size_t size, const Pattern& pattern) -> const void*
+            {
+                return pattern.templated(buf, size);
+            }
+        },
+        {
+            "mask",
+            [](const unsigned char* const buf, const size_t size, const Pattern& pattern) -> const void*
+            {
+                return Sig::find<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>(buf, size, pattern.sig, pattern.mask, pattern.length);
+            }
+        },
+        {
+            "subpattern",
+            [](const unsigned char* const buf, const size_t size, const Pattern& pattern) -> const void*
+            {
+                return Sig::find<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>, Sig::Mask::BitMask<'m'>>(
+                    buf, size, pattern.sig, pattern.subsig, pattern.subpatternMask, pattern.length
+                );
+            }
+        },
+        {
+            "bitmask",
+            [](const unsigned char* const buf, const size_t size, const Pattern& pattern) -> const void*
+            {
+                return Sig::bitmask(buf, size, pattern.bytes, pattern.msk, pattern.length);
+            }
+        },
+        {
+            "one-line",
+            [](const unsigned char* const buf, const size_t size, const Pattern& pattern) -> const void*
+            {
+                return Sig::find(buf, size, pattern.line.c_str());
+            }
+        }
+    };
+
+    struct Result
+    {
+        const char* engine;
+        const char* corpus;
+        size_t size;
+        size_t length;
+        size_t density;
+        Position position;
+        long long found;     // Offset of the match or -1
+        unsigned long long runs;
+        double seconds;      // The best run
+        double gbps;
+        double nsPerCandidate;
+    };
+
+    struct Options
+    {
+        std::vector<unsigned long long> sizes{ 4ull << 10, 64ull << 10, 1ull << 20, 16ull << 20, 256ull << 20 };
+        std::vector<std::string> engines;
+        std::string corpus;
+        double minTime = 0.05;
+        std::string json;
+    };
+
+    std::vector<std::string> split(const std::string& list)
+    {
+        std::vector<std::string> items;
+        size_t begin = 0;
+        while (begin <= list.size())
+        {
+            const auto end = list.find(',', begin);
+            const auto item = list.substr(begin, (end == std::string::npos) ? std::string::npos : (end - begin));
+            if (!item.empty())
+            {
+                items.push_back(item);
+            }
+
+            if (end == std::string::npos)
+            {
+                break;
+            }
+
+            begin = end + 1;
+        }
+
+        return items;
+    }
+
+    // 4K, 16M, 4G or bytes:
+    bool parseSize(const std::string& text, unsigned long long& size)
+    {
+        char* end = nullptr;
+        size = strtoull(text.c_str(), &end, 10);
+        switch (*end)
+        {
+        case 'K':
+        case 'k':
+            size <<= 10;
+            ++end;
+            break;
+        case 'M':
+        case 'm':
+            size <<= 20;
+            ++end;
+            break;
+        case 'G':
+        case 'g':
+            size <<= 30;
+            ++end;
+            break;
+        default:
+            break;
+        }
+
+        return size && (end != text.c_str()) && (*end == '\0');
+    }
+
+    bool parseOptions(const int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string option = argv[i];
+            if ((i + 1) >= argc)
+            {
+                return false;
+            }
+
+            const std::string value = argv[++i];
+            if (option == "--sizes")
+            {
+                options.sizes.clear();
+                for (const auto& item : split(value))
+                {
+                    unsigned long long size = 0;
+                    if (!parseSize(item, size))
+                    {
+                        return false;
+                    }
+
+                    options.sizes.push_back(size);
+                }
+            }
+            else if (option == "--engines")
+            {
+                options.engines = split(value);
+            }
+            else if (option == "--corpus")
+            {
+                options.corpus = value;
+            }
+            else if (option == "--min-time")
+            {
+                options.minTime = strtod(value.c_str(), nullptr) / 1000.0;
+            }
+            else if (option == "--json")
+            {
+                options.json = value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool selected(const Options& options, const char* const engine)
+    {
+        if (options.engines.empty())
+        {
+            return true;
+        }
+
+        for (const auto& name : options.engines)
+        {
+            if (name == engine)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::vector<unsigned char> readFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void fillRandom(std::vector<unsigned char>& buf)
+    {
+        std::mt19937_64 random(0x5167);
+        for (size_t i = 0; i < buf.size(); i += sizeof(unsigned long long))
+        {
+            const auto value = random();
+            memcpy(&buf[i], &value, ((buf.size() - i) < sizeof(value)) ? (buf.size() - i) : sizeof(value));
+        }
+    }
+
+    void fillCode(std::vector<unsigned char>& buf, const std::vector<unsigned char>& code)
+    {
+        for (size_t i = 0; i < buf.size(); i += code.size())
+        {
+            memcpy(&buf[i], code.data(), ((buf.size() - i) < code.size()) ? (buf.size() - i) : code.size());
+        }
+    }
+
+    // Runs the search until the minimal time is spent, the best run is taken:
+    Result measure(const Engine& engine, const Pattern& pattern, const unsigned char* const buf, const size_t size, const double minTime)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        Result result{};
+        result.engine = engine.name;
+        result.size = size;
+        result.length = pattern.length;
+        result.density = pattern.density;
+        result.found = -1;
+        result.seconds = 1e30;
+
+        double spent = 0;
+        do
+        {
+            const auto begin = Clock::now();
+            const auto* const found = static_cast<const unsigned char*>(engine.find(buf, size, pattern));
+            const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+            result.found = found ? static_cast<long long>(found - buf) : -1;
+            result.seconds = (seconds < result.seconds) ? seconds : result.seconds;
+            spent += seconds;
+            ++result.runs;
+        } while (spent < minTime);
+
+        const auto scanned = static_cast<double>((result.found >= 0) ? (static_cast<size_t>(result.found) + pattern.length) : size);
+        const auto candidates = static_cast<double>((result.found >= 0) ? (static_cast<size_t>(result.found) + 1) : (size - pattern.length + 1));
+        result.gbps = (result.seconds > 0) ? (scanned / result.seconds / 1e9) : 0;
+        result.nsPerCandidate = result.seconds * 1e9 / candidates;
+        return result;
+    }
+
+    void scanCorpus(const Options& options, const char* const corpus, std::vector<unsigned char>& buf, std::vector<Result>& results)
+    {
+        const auto size = buf.size();
+        for (const auto length : k_lengths)
+        {
+            if (size < (2 * length))
+            {
+                continue;
+            }
+
+            for (const auto density : k_densities)
+            {
+                const Pattern pattern(length, density);
+
+                // Natural occurrences (e.g. of the patterns compiled into the benchmark itself) are broken by the last byte,
+                // so the pattern is found only where it's planted:
+                std::vector<std::pair<size_t, unsigned char>> broken;
+                for (const void* found = Sig::bitmask(buf.data(), size, pattern.bytes, pattern.msk, length); found; )
+                {
+                    const auto pos = static_cast<size_t>(static_cast<const unsigned char*>(found) - buf.data());
+                    broken.emplace_back(pos + length - 1, buf[pos + length - 1]);
+                    buf[pos + length - 1] ^= 0xFF;
+                    found = Sig::bitmask(&buf[pos + 1], size - pos - 1, pattern.bytes, pattern.msk, length);
+                }
+
+                for (const auto position : { Position::early, Position::late, Position::none })
+                {
+                    // The pattern is planted into the buffer and the original bytes are restored after the scans:
+                    const size_t offset = (position == Position::early) ? (size / 64) : (size - length);
+                    unsigned char original[k_maxLength]{};
+                    if (position != Position::none)
+                    {
+                        memcpy(original, &buf[offset], length);
+                        memcpy(&buf[offset], pattern.bytes, length);
+                    }
+
+                    for (const auto& engine : k_engines)
+                    {
+                        if (!selected(options, engine.name))
+                        {
+                            continue;
+                        }
+
+                        auto result = measure(engine, pattern, buf.data(), size, options.minTime);
+                        result.corpus = corpus;
+                        result.position = position;
+                        results.push_back(result);
+
+                        printf(
+                            "%-10s %-6s %12llu %3zu %3zu%% %-5s %9.3f GB/s %9.4f ns/candidate  found %lld\n",
+                            result.engine,
+                            result.corpus,
+                            static_cast<unsigned long long>(result.size),
+                            result.length,
+                            result.density * 25,
+                            k_positions[static_cast<size_t>(result.position)],
+                            result.gbps,
+                            result.nsPerCandidate,
+                            result.found
+                        );
+                        fflush(stdout);
+                    }
+
+                    if (position != Position::none)
+                    {
+                        memcpy(&buf[offset], original, length);
+                    }
+                }
+
+                for (auto entry = broken.rbegin(); entry != broken.rend(); ++entry)
+                {
+                    buf[entry->first] = entry->second;
+                }
+            }
+        }
+    }
+
+    bool writeJson(const std::string& path, const std::vector<Result>& results)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        char line[512]{};
+        snprintf(line, sizeof(line), "{\n  \"isa\": \"%s\",\n  \"results\": [\n", Sig::Simd::k_isaNames[static_cast<size_t>(Sig::isa())]);
+        file << line;
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& result = results[i];
+            snprintf(
+                line,
+                sizeof(line),
+                "    { \"engine\": \"%s\", \"corpus\": \"%s\", \"size\": %llu, \"length\": %zu, \"wildcard_percent\": %zu, \"position\": \"%s\", "
+                "\"found\": %lld, \"runs\": %llu, \"seconds\": %.9g, \"gbps\": %.6g, \"ns_per_candidate\": %.6g }%s\n",
+                result.engine,
+                result.corpus,
+                static_cast<unsigned long long>(result.size),
+                result.length,
+                result.density * 25,
+                k_positions[static_cast<size_t>(result.position)],
+                result.found,
+                result.runs,
+                result.seconds,
+                result.gbps,
+                result.nsPerCandidate,
+                ((i + 1) < results.size()) ? "," : ""
+            );
+            file << line;
+        }
+
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printf("Usage: %s [--sizes 4K,64K,1M,16M,256M] [--engines template,mask,subpattern,bitmask,one-line] [--corpus path] [--min-time ms] [--json path]\n", argv[0]);
+        return 1;
+    }
+
+    const auto code = readFile(options.corpus.empty() ? argv[0] : options.corpus);
+    if (code.empty())
+    {
+        printf("The corpus of code can't be read, only the random corpus is scanned\n");
+    }
+
+    printf("Kernels: %s\n", Sig::Simd::k_isaNames[static_cast<size_t>(Sig::isa())]);
+
+    std::vector<Result> results;
+    for (const auto size : options.sizes)
+    {
+        if (size > static_cast<size_t>(-1))
+        {
+            printf("The buffer of %llu bytes doesn't fit the address space\n", size);
+            continue;
+        }
+
+        std::vector<unsigned char> buf(static_cast<size_t>(size));
+
+        fillRandom(buf);
+        scanCorpus(options, "random", buf, results);
+
+        if (!code.empty())
+        {
+            fillCode(buf, code);
+            scanCorpus(options, "code", buf, results);
+        }
+    }
+
+    if (!options.json.empty() && !writeJson(options.json, results))
+    {
+        printf("Can't write %s\n", options.json.c_str());
+        return 1;
+    }
+
+    return 0;
+}
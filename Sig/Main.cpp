@@ -1,7 +1,24 @@
 ﻿#include <Sig/Sig.hpp>
+#include <Sig/PatternSet.hpp>
+#include <Sig/Parallel.hpp>
+#include <Sig/Stream.hpp>
+#include <Sig/File.hpp>
+#include <Sig/Process.hpp>
+#include <Sig/Elf.hpp>
+#include <Sig/Cache.hpp>
 
 #include <intrin.h>
 
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#ifdef __linux__
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+
 #define sig_assert(cond) if (!(cond)) { __int2c(); }
 
 
@@ -35,6 +52,22 @@ namespace
         template <typename Type, Type... vals>
         using Custom = Sig::Holder<Type, CustomCmp, vals...>;
 
+        // Entries of ranges take exactly one value:
+        template <auto val>
+        using RangeByte = Sig::Byte<static_cast<unsigned char>(val)>;
+
+        template <auto val>
+        using RangeChar = Sig::Char<static_cast<char>(val)>;
+
+        template <auto val>
+        using RangeDword = Sig::Dword<static_cast<unsigned int>(val)>;
+
+        // All bytes are equally frequent:
+        struct Flat
+        {
+            static constexpr unsigned short k_table[256]{};
+        };
+
         void runTests()
         {
             const void* found = nullptr;
@@ -99,6 +132,43 @@ namespace
             found = Sig::find<Sig::Rep<Sig::Char<'r'>, 6>, Sig::Char<'t', 'e', 'x', 't'>>(g_arr, sizeof(g_arr));
             sig_assert(found == &g_arr[30]);
 
+            found = Sig::find<Sig::Rep<Sig::Byte<3, 3>, 2>>(g_arr, sizeof(g_arr)); // Repeats follow each other by the size of the tag
+            sig_assert(found == nullptr);
+
+            found = Sig::find<Sig::Rep<Sig::Byte<4, 4>, 2>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[10]);
+
+            // Greedy repeats from min to max times:
+            found = Sig::find<Sig::RepRange<Sig::Char<'r'>, 2, 10>, Sig::Char<'t'>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[30]);
+
+            found = Sig::find<Sig::RepRange<Sig::Char<'r'>, 1, 4>, Sig::Char<'t'>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[32]);
+
+            found = Sig::find<Sig::RepRange<Sig::Char<'r'>, 7, 10>, Sig::Char<'t'>>(g_arr, sizeof(g_arr));
+            sig_assert(found == nullptr);
+
+            // Runs of one byte are measured once, too short runs and the runs at the end of the buffer are skipped:
+            std::vector<unsigned char> padding(4096, 0x90);
+            memset(&padding[100], 0xCC, 299);
+            memset(&padding[1000], 0xCC, 300);
+            memset(&padding[3900], 0xCC, 196);
+            found = Sig::find<Sig::Rep<Sig::Byte<0xCC>, 300>>(padding.data(), padding.size());
+            sig_assert(found == &padding[1000]);
+
+            found = Sig::find<Sig::Rep<Sig::Dword<0xCCCCCCCC>, 75>>(&padding[1001], padding.size() - 1001);
+            sig_assert(found == nullptr);
+
+            found = Sig::find<Sig::Rep<Sig::Byte<0xCC>, 196>>(&padding[1001], padding.size() - 1001);
+            sig_assert(found == &padding[1001]);
+
+            found = Sig::find<Sig::Rep<Sig::Byte<0xCC>, 197>>(&padding[1300], padding.size() - 1300);
+            sig_assert(found == nullptr);
+
+            // Large counts don't unroll in compile-time:
+            found = Sig::find<Sig::Rep<Sig::Byte<0x00>, 1000000>>(g_arr, sizeof(g_arr));
+            sig_assert(found == nullptr);
+
             found = Sig::find<Sig::Byte<0x10>, Sig::CmpByte<Sig::Cmp::NotEq, 0x00, 0x00, 0x00, 0x00>, Sig::Byte<0x15>>(g_arr, sizeof(g_arr));
             sig_assert(found == &g_arr[14]);
 
@@ -117,6 +187,97 @@ namespace
             found = Sig::find<Custom<unsigned char, 2, 4, 4, 6, 6, 6>>(g_arr, sizeof(g_arr));
             sig_assert(found == &g_arr[4]);
 
+            using Anchored = Sig::Anchors<Sig::X64Frequency, Sig::Byte<>, Sig::Byte<0x11, 0x22>, Sig::Dword<>, Sig::Word<0x4433>, Sig::Set<Sig::Byte<0x55>>>;
+            static_assert(Anchored::k_exists && (Anchored::k_first == 2) && (Anchored::k_last == 7)); // 0x22 and 0x33 are the rarest
+            static_assert(Anchored::k_layout.size == 9);
+            static_assert(!Sig::Anchors<Sig::X64Frequency, Sig::Byte<>, Sig::CmpByte<Sig::Cmp::NotEq, 0x00>>::k_exists);
+            static_assert((Sig::Anchors<Sig::X64Frequency, Sig::Byte<0x00, 0x00, 0x00, 0x00>>::k_first == 0) && (Sig::Anchors<Sig::X64Frequency, Sig::Byte<0x00, 0x00, 0x00, 0x00>>::k_last == 3));
+
+            using Ranked = Sig::Run<Sig::X64Frequency, 4, Sig::Byte<0x48>, Sig::CmpByte<Sig::Cmp::Gr, 0x10>, Sig::Dword<>, Sig::Byte<0x9A>, Sig::Set<Sig::Byte<0x00>>>;
+            static_assert((Ranked::k_order.entry[0] == 3) && (Ranked::k_order.entry[1] == 0) && (Ranked::k_order.entry[2] == 1) && (Ranked::k_order.entry[3] == 2));
+            static_assert((Ranked::k_order.offset[0] == 6) && (Ranked::k_order.offset[1] == 0) && (Ranked::k_size == 7));
+            static_assert(Sig::Set<Sig::Byte<0x11>, Sig::Word<0x2222>>::k_size == 2); // The size of the largest entry
+
+            using Fused = Sig::FusedComparator<Sig::X64Frequency, Sig::Byte<0x11>, Sig::Word<>, Sig::Rep<Sig::Byte<0x44>, 2>, Sig::CmpByte<Sig::Cmp::Gr, 0x10>, Sig::Byte<0x77, 0x88>>;
+            static_assert((Fused::k_prefix.count == 3) && (Fused::k_prefix.size == 5));
+            static_assert((Fused::k_span == 8) && (Fused::k_words.count == 1) && (Fused::k_words.msk[0] == 0xFFFF00FFFF0000FFull));
+            static_assert(Sig::FusedComparator<Sig::X64Frequency, Sig::Set<Sig::Byte<0x11>>, Sig::Byte<0x22>>::k_prefix.count == 0);
+
+            // The last entry of a set isn't read past the end of the buffer ("te" follows it):
+            found = Sig::find<Sig::Set<Sig::Byte<0x00>, Sig::Word<0x6574>>>(&g_arr[36], 1);
+            sig_assert(found == nullptr);
+
+            found = Sig::find<Sig::Byte<>, Sig::Byte<0x33>, Sig::Byte<>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[42]);
+
+            found = Sig::find<Sig::Byte<0x11, 0x22>, Sig::Word<>, Sig::Dword<0x88776655>, Sig::Byte<0x99, 0xAA, 0xBB, 0xCC>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[41]);
+
+            found = Sig::find<Sig::Byte<0x11, 0x22>, Sig::Word<>, Sig::Dword<0x88776655>, Sig::Byte<0x99, 0xAA, 0xBB, 0xCD>>(g_arr, sizeof(g_arr));
+            sig_assert(found == nullptr);
+
+            found = Sig::find<Sig::Byte<0x22>, Sig::CmpByte<Sig::Cmp::Gr, 0x32>, Sig::Byte<0x44>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[42]);
+
+            found = Sig::find<Sig::Byte<0x1E>, Sig::Set<Sig::Byte<0x1F>, Sig::Word<0xFFFF>>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[28]);
+
+            found = Sig::find<Sig::CmpByte<Sig::Cmp::Gr, 0x1C>, Sig::Set<Sig::Word<0xFFFF>, Sig::Byte<0x1E>>, Sig::CmpByte<Sig::Cmp::Le, 0x20>, Sig::Char<'r'>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[27]);
+
+            // Sets of many alternatives skip the data that no alternative starts with, the first matched alternative is taken:
+            using Encodings = Sig::Set<Sig::Byte<0xAA>, Sig::Word<0x1F1E>, Sig::Byte<0x1E>, Sig::Compound<Sig::Byte<0xBB>, Sig::Word<>>>;
+            static_assert(Sig::SetCmp::FirstBytes<Sig::Byte<0xAA>, Sig::Word<0x1F1E>, Sig::CmpByte<Sig::Cmp::Gr, 0x10>>::build().starts[0x00]);
+            static_assert(!Sig::SetCmp::FirstBytes<Sig::Byte<0xAA>, Sig::Word<0x1F1E>>::build().starts[0x1F]);
+
+            found = Sig::find<Sig::Byte<0x1D>, Encodings, Sig::Char<'r'>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[27]);
+
+            found = Sig::find<Sig::Byte<0x1D>, Sig::Set<Sig::Byte<0xAA>, Sig::Byte<0x1E>, Sig::Word<0x1F1E>, Sig::Byte<0xBB>>, Sig::Char<'r'>>(g_arr, sizeof(g_arr));
+            sig_assert(found == nullptr);
+
+            found = Sig::findRanked<Flat, Sig::Byte<0x11>, Sig::Word<>, Sig::Byte<0x44>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[41]);
+
+            found = Sig::findRanked<Flat, Sig::Byte<0x11>, Sig::Word<>, Sig::Byte<0x45>>(g_arr, sizeof(g_arr));
+            sig_assert(found == nullptr);
+
+            unsigned char wide[200]{};
+            wide[100] = 0xAB;
+            wide[105] = 0xCD;
+            wide[194] = 0xAB;
+            wide[199] = 0xCD;
+
+            found = Sig::find<Sig::Byte<0xAB>, Sig::Dword<>, Sig::Byte<0xCD>>(wide, sizeof(wide));
+            sig_assert(found == &wide[100]);
+
+            found = Sig::find<Sig::Byte<0xAB>, Sig::Dword<>, Sig::Byte<0xCD>>(&wide[101], sizeof(wide) - 101);
+            sig_assert(found == &wide[194]);
+
+            found = Sig::find<Sig::Byte<0xAB>, Sig::Dword<>, Sig::Byte<0xCD>>(&wide[101], sizeof(wide) - 102);
+            sig_assert(found == nullptr);
+
+            found = Sig::find<Sig::Range<RangeByte, 0x1C, 0x1F>, Sig::Char<'r'>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[29]);
+
+            found = Sig::find<Sig::Range<RangeByte, 0x1C, 0x1E>, Sig::Char<'r'>>(g_arr, sizeof(g_arr));
+            sig_assert(found == nullptr);
+
+            found = Sig::find<Sig::Range<RangeChar, -16, 0x10>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[4]);
+
+            found = Sig::find<Sig::Range<RangeDword, 0x33000000, 0x33FFFFFF>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[40]);
+
+            found = Sig::find<Sig::Range<RangeDword, 0, 0xFFFFFFFF>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[0]);
+
+            // Common leading bits of the bounds are known bytes of the layout:
+            using Bounded = Sig::Range<RangeDword, 0x00401000, 0x00401FFF>;
+            static_assert(Sig::RangeCmp::bounded<Bounded>() && !Sig::RangeCmp::bounded<Sig::Range<RangeByte, 2, 1>>());
+            static_assert((Sig::Footprint::build<Bounded>().msk[3] == 0xFF) && (Sig::Footprint::build<Bounded>().msk[2] == 0xFF));
+            static_assert((Sig::Footprint::build<Bounded>().msk[1] == 0xF0) && (Sig::Footprint::build<Bounded>().val[1] == 0x10));
+
 #if (__cplusplus >= 202002) || _HAS_CXX20
             found = Sig::find<Sig::StrEq<"text">>(g_arr, sizeof(g_arr));
             sig_assert(found == &g_arr[36]);
@@ -230,6 +391,43 @@ namespace
 
             found = Sig::find<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>(g_arr, sizeof(g_arr), "\x01\x02\x02\x03\x03\x03", "....u.");
             sig_assert(found == nullptr);
+
+            found = Sig::find<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>(&g_arr[5], sizeof(g_arr) - 5, "xxxx", "????");
+            sig_assert(found == &g_arr[5]);
+
+            const Sig::MaskProgram<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>> lowered("t_xt", nullptr, ".?..", 4);
+            sig_assert(lowered.form() == decltype(lowered)::Form::lowered);
+            sig_assert(lowered.find(g_arr, sizeof(g_arr)) == &g_arr[36]);
+
+            const Sig::MaskProgram<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>, Sig::Mask::NotEq<'!'>> opcodes("\x1A?\x00\x1D", nullptr, ".?!.", 4);
+            sig_assert(opcodes.form() == decltype(opcodes)::Form::opcodes);
+            sig_assert(opcodes.find(g_arr, sizeof(g_arr)) == &g_arr[24]);
+
+            const Sig::MaskProgram<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>> unknown("text", nullptr, ".u..", 4);
+            sig_assert(!unknown.valid() && (unknown.find(g_arr, sizeof(g_arr)) == nullptr));
+
+            const Sig::MaskProgram<Sig::Mask::Eq<'.'>, Sig::Mask::BitMask<'m'>> noSubsig("text", nullptr, ".m..", 4);
+            sig_assert(!noSubsig.valid());
+
+            // Longer than the inline storage:
+            std::vector<char> longSig(300, 'r');
+            std::vector<char> longMask(300, '!');
+            std::vector<unsigned char> longBuf(1000, 'r');
+            longSig[299] = 'x';
+            longMask[299] = '.';
+            longBuf[900] = 'x';
+            longBuf[850] = 's';
+            const Sig::MaskProgram<Sig::Mask::Eq<'.'>, Sig::Mask::LeEq<'!'>> longProgram(longSig.data(), nullptr, longMask.data(), longMask.size());
+            sig_assert(longProgram.form() == decltype(longProgram)::Form::opcodes);
+            sig_assert(longProgram.find(longBuf.data(), longBuf.size()) == nullptr);
+
+            longBuf[850] = 'a';
+            sig_assert(longProgram.find(longBuf.data(), longBuf.size()) == &longBuf[601]);
+
+            // Shorter than the inline storage, but every position needs an instruction:
+            const Sig::MaskProgram<Sig::Mask::Eq<'.'>, Sig::Mask::LeEq<'!'>> wideProgram(longSig.data() + 180, nullptr, longMask.data() + 180, 120);
+            sig_assert(wideProgram.form() == decltype(wideProgram)::Form::opcodes);
+            sig_assert(wideProgram.find(longBuf.data(), longBuf.size()) == &longBuf[781]);
         }
     }
 
@@ -262,6 +460,116 @@ namespace
 
             found = Sig::bitmask(g_arr, sizeof(g_arr), "\x00\x11\x22\xFF", "\xFF\x00\xFF\x03", 4);
             sig_assert(found == &g_arr[40]);
+
+            found = Sig::bitmask(g_arr, sizeof(g_arr), "\x00\x00", "\x00\x00", 2);
+            sig_assert(found == &g_arr[0]);
+
+            found = Sig::bitmask(g_arr, sizeof(g_arr), "\x00\x11", "\xFF\xFF", sizeof(g_arr) + 1);
+            sig_assert(found == nullptr);
+
+            // Patterns that are kept in one, two or four registers and that are longer than registers,
+            // found in the middle and at the very end of the buffer where the registers can't be loaded:
+            unsigned char seq[256]{};
+            unsigned char msk[256]{};
+            for (size_t i = 0; i < sizeof(seq); ++i)
+            {
+                seq[i] = static_cast<unsigned char>(i);
+                msk[i] = ((i % 3) == 1) ? 0x0F : 0xFF;
+            }
+
+            const size_t sizes[]{ 1, 15, 16, 17, 32, 33, 63, 64, 65, 100, 255 };
+            for (const size_t sigsize : sizes)
+            {
+                const size_t middle = (sizeof(seq) - sigsize) / 2;
+                found = Sig::bitmask(seq, sizeof(seq), &seq[middle], msk, sigsize);
+                sig_assert(found == &seq[middle]);
+
+                const size_t last = sizeof(seq) - sigsize;
+                found = Sig::bitmask(seq, sizeof(seq), &seq[last], msk, sigsize);
+                sig_assert(found == &seq[last]);
+
+                found = Sig::bitmask(seq, sizeof(seq) - 1, &seq[last], msk, sigsize);
+                sig_assert(found == nullptr);
+            }
+
+            // Shift-Or tables of one, two and four words, classes are built from the value/mask form:
+            std::vector<unsigned char> wide(64 * 1024);
+            for (size_t i = 0; i < wide.size(); ++i)
+            {
+                wide[i] = static_cast<unsigned char>((i * 7) % 251);
+            }
+
+            for (const size_t sigsize : { size_t(1), size_t(64), size_t(65), size_t(128), size_t(129), size_t(256) })
+            {
+                const size_t at = wide.size() - sigsize - 1000;
+                const auto build = [&wide, &msk, at, sigsize](auto& table)
+                {
+                    for (size_t i = 0; i < sigsize; ++i)
+                    {
+                        for (unsigned int byte = 0; byte < 256; ++byte)
+                        {
+                            if ((byte & msk[i]) == (wide[at + i] & msk[i]))
+                            {
+                                table.allow(i, static_cast<unsigned char>(byte));
+                            }
+                        }
+                    }
+                };
+
+                const auto fallback = []() -> const void*
+                {
+                    return nullptr;
+                };
+
+                const void* const expected = Sig::bitmask(wide.data(), wide.size(), &wide[at], msk, sigsize);
+                found = Sig::Bitap::find(wide.data(), wide.size(), sigsize, build, fallback);
+                sig_assert((found == expected) && (found != nullptr));
+            }
+
+            // Long patterns are verified by masked words, the buffer repeats every 251 bytes so each period is a candidate:
+            std::vector<unsigned char> longVal(&wide[1000], &wide[1000] + 603);
+            std::vector<unsigned char> longMsk(longVal.size(), 0xFF);
+            longMsk[300] = 0xF0;
+            longVal[300] ^= 0x0F;
+            longMsk[601] = 0x00;
+            longVal[601] ^= 0xFF;
+            found = Sig::bitmask(wide.data(), wide.size(), longVal.data(), longMsk.data(), longVal.size());
+            sig_assert(found == &wide[1000 % 251]);
+
+            longVal[300] ^= 0x10;
+            found = Sig::bitmask(wide.data(), wide.size(), longVal.data(), longMsk.data(), longVal.size());
+            sig_assert(found == nullptr);
+
+            // Wildcards and comparators without exact bytes are matched by Sig::ShiftOr:
+            std::vector<unsigned char> ramp(16 * 1024, 0x50);
+            ramp[12000] = 0x10;
+            ramp[12002] = 0x20;
+            ramp[12005] = 0x30;
+            const Sig::MaskProgram<Sig::Mask::Any<'_'>, Sig::Mask::Le<'<'>> ranged("\x11_\x21__\x31", nullptr, "<_<__<", 6);
+            found = ranged.find(ramp.data(), ramp.size());
+            sig_assert(found == &ramp[12000]);
+
+            // The longest run of exact bytes is searched by Sig::Horspool in the scalar scan,
+            // partial copies of the run and copies with a wrong wildcarded byte are skipped:
+            const unsigned char runVal[]{ 0x10, 0x00, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x00, 0x20 };
+            const unsigned char runMsk[]{ 0xFF, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0xF0 };
+            size_t runOffset = 0;
+            sig_assert(Sig::Simd::longestRun(runMsk, sizeof(runMsk), runOffset) == 7);
+            sig_assert(runOffset == 2);
+
+            std::vector<unsigned char> text(4096, 0x41);
+            memcpy(&text[1000], "\x10\x00\x41\x42\x43\x44\x45\x46", 8);
+            memcpy(&text[2000], "\x11\x00\x41\x42\x43\x44\x45\x46\x47\x00\x20", 11);
+            memcpy(&text[3000], "\x10\x99\x41\x42\x43\x44\x45\x46\x47\x99\x2F", 11);
+            memcpy(&text[text.size() - 11], runVal, 11);
+            found = Sig::Simd::findMasked<Sig::Simd::Scalar>(text.data(), text.size(), runVal, runMsk, sizeof(runMsk));
+            sig_assert(found == &text[3000]);
+
+            found = Sig::Simd::findMasked<Sig::Simd::Scalar>(&text[3001], text.size() - 3001, runVal, runMsk, sizeof(runMsk));
+            sig_assert(found == &text[text.size() - 11]);
+
+            found = Sig::bitmask(text.data(), text.size(), runVal, runMsk, sizeof(runMsk));
+            sig_assert(found == &text[3000]);
         }
     }
 
@@ -303,15 +611,767 @@ namespace
 
             found = Sig::find(g_arr, sizeof(g_arr), "       c3   ");
             sig_assert(found == &g_arr[63]);
+
+            // Tokens after the compiled head (kernelmode builds compare the rest of long patterns by them):
+            unsigned char val[2]{};
+            unsigned char msk[2]{};
+            const char* const tail = Sig::OneLine::parseTokens(" 0F ? e9 ?? ? ? ? c3", val, msk, 2);
+            sig_assert((val[0] == 0x0F) && (msk[0] == 0xFF) && (msk[1] == 0x00));
+            sig_assert(Sig::OneLine::matches(tail, &g_arr[58], 6));
+            sig_assert(!Sig::OneLine::matches(tail, &g_arr[57], 6));
+
+#if (__cplusplus >= 202002) || _HAS_CXX20
+            // Parsed in compile-time, malformed patterns like Sig::Pat<"X 11"> don't compile:
+            static_assert(std::is_same_v<Sig::Pat<"0F ? e9">, Sig::Compound<Sig::Byte<0x0F>, Sig::Byte<>, Sig::Byte<0xE9>>>);
+            static_assert(std::is_same_v<Sig::Pat<"48 8B ? ? 89 05">, Sig::Compound<Sig::Byte<0x48>, Sig::Byte<0x8B>, Sig::Byte<>, Sig::Byte<>, Sig::Byte<0x89>, Sig::Byte<0x05>>>);
+            static_assert(Sig::Pat<"  1 2 ?? 3 ">::k_size == 4);
+
+            found = Sig::find<Sig::Pat<"1 2 2 3 3 3 4 4 4 4">>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[4]);
+
+            found = Sig::find<Sig::Pat<"0 11 ? ?? 44 55 66 77      88 99 aa bB     Cc dD   EE ?">>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[40]);
+
+            found = Sig::find<Sig::Pat<"F 5 E9">, Sig::Dword<>, Sig::Pat<"c3">>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[56]);
+
+            found = Sig::find<Sig::Pat<"?">>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[0]);
+
+            found = Sig::find<Sig::Pat<"DE AD BE EF">>(g_arr, sizeof(g_arr));
+            sig_assert(found == nullptr);
+#endif
+        }
+    }
+
+    namespace CompiledTests
+    {
+        void runTests()
+        {
+            const void* found = nullptr;
+
+            const Sig::Pattern invalid("X 11 ? ?? 44");
+            sig_assert(!invalid.valid());
+
+            found = Sig::find(g_arr, sizeof(g_arr), invalid);
+            sig_assert(found == nullptr);
+
+            const Sig::Pattern pattern("0 11 ? ?? 44 55 66 77");
+            sig_assert(pattern.valid());
+            sig_assert(pattern.size() == 8);
+
+            found = Sig::find(g_arr, sizeof(g_arr), pattern);
+            sig_assert(found == &g_arr[40]);
+
+            found = pattern.find(g_arr, 47);
+            sig_assert(found == nullptr);
+
+            found = pattern.find(g_arr, 48);
+            sig_assert(found == &g_arr[40]);
+
+            const Sig::FixedPattern<4> fixed("F 5 E9 ?");
+            sig_assert(fixed.valid());
+
+            found = Sig::find(g_arr, sizeof(g_arr), fixed);
+            sig_assert(found == &g_arr[56]);
+
+            const Sig::FixedPattern<2> tooSmall("F 5 E9");
+            sig_assert(!tooSmall.valid());
+
+            found = tooSmall.find(g_arr, sizeof(g_arr));
+            sig_assert(found == nullptr);
+
+            Sig::Pattern moved;
+            moved = Sig::Pattern("AA bb cC Dd");
+            found = moved.find(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[50]);
+
+            // Longer than Sig::k_inlinePatternCapacity, so the one-line Sig::find compiles it into the heap:
+            static const unsigned char k_zeroes[Sig::k_inlinePatternCapacity * 2]{};
+            char longSig[(Sig::k_inlinePatternCapacity + 1) * 2 + 1]{};
+            for (size_t i = 0; i <= Sig::k_inlinePatternCapacity; ++i)
+            {
+                longSig[i * 2] = (i == 1) ? '?' : '0';
+                longSig[i * 2 + 1] = ' ';
+            }
+
+            found = Sig::find(k_zeroes, sizeof(k_zeroes), longSig);
+            sig_assert(found == &k_zeroes[0]);
+
+            found = Sig::find(k_zeroes, Sig::k_inlinePatternCapacity, longSig);
+            sig_assert(found == nullptr);
+        }
+    }
+
+    namespace FindAllTests
+    {
+        void runTests()
+        {
+            size_t count = 0;
+
+            count = 0;
+            for (const void* found : Sig::findAll<Sig::Char<'r'>>(g_arr, sizeof(g_arr)))
+            {
+                sig_assert(found == &g_arr[30 + count]);
+                ++count;
+            }
+            sig_assert(count == 6);
+
+            count = Sig::findAll<Sig::Char<'r', 'r'>>(g_arr, sizeof(g_arr)).visit([](const void*) {});
+            sig_assert(count == 5);
+
+            count = Sig::findAll<Sig::Char<'r', 'r'>>(g_arr, sizeof(g_arr), Sig::Overlap::denied).visit([](const void*) {});
+            sig_assert(count == 3);
+
+            const void* last = nullptr;
+            count = Sig::findAll<Sig::Char<'r'>>(g_arr, sizeof(g_arr)).visit([&last](const void* const found) -> bool
+            {
+                last = found;
+                return found != &g_arr[31];
+            });
+            sig_assert(count == 2);
+            sig_assert(last == &g_arr[31]);
+
+            count = Sig::findAll<Sig::Char<'r'>>(g_arr, 0).visit([](const void*) {});
+            sig_assert(count == 0);
+
+            count = Sig::findAll<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>(g_arr, sizeof(g_arr), "\x04\x04", "..").visit([](const void*) {});
+            sig_assert(count == 3);
+
+            count = Sig::findAll<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>(g_arr, sizeof(g_arr), "\x04\x04", "..", Sig::Overlap::denied).visit([](const void*) {});
+            sig_assert(count == 2);
+
+            count = Sig::findAll<Sig::Mask::Eq<'.'>, Sig::Mask::BitMask<'m'>>(g_arr, sizeof(g_arr), "\x0A", "\x0F", "m").visit([](const void*) {});
+            sig_assert(count == 2);
+
+            count = Sig::findAll<Sig::Mask::Eq<'.'>>(g_arr, sizeof(g_arr), nullptr, "..").visit([](const void*) {});
+            sig_assert(count == 0);
+
+            count = Sig::findAll(g_arr, sizeof(g_arr), "04 04").visit([](const void*) {});
+            sig_assert(count == 3);
+
+            count = Sig::findAll(g_arr, sizeof(g_arr), "?", Sig::Overlap::denied).visit([](const void*) {});
+            sig_assert(count == sizeof(g_arr));
+
+            count = Sig::findAll(g_arr, sizeof(g_arr), "X").visit([](const void*) {});
+            sig_assert(count == 0);
+
+            const Sig::Pattern pattern("72 ? 72");
+            count = Sig::findAll(g_arr, sizeof(g_arr), pattern).visit([](const void*) {});
+            sig_assert(count == 4);
+
+            count = Sig::findAll(g_arr, sizeof(g_arr), pattern, Sig::Overlap::denied).visit([](const void*) {});
+            sig_assert(count == 2);
+
+            const void* matches[2]{};
+            count = 0;
+            for (const void* found : Sig::bitmaskAll(g_arr, sizeof(g_arr), "\x0A", "\x0F", 1))
+            {
+                matches[count++] = found;
+            }
+            sig_assert(count == 2);
+            sig_assert(matches[0] == &g_arr[24]);
+            sig_assert(matches[1] == &g_arr[50]);
+        }
+    }
+
+    namespace PatternSetTests
+    {
+        void runTests()
+        {
+            Sig::PatternSet set;
+
+            const size_t oneLine = set.add("1 2 2 3 3 3 4 4 4 4");
+            const size_t mask = set.add<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>("\x0F\x05\xE9xxxx\xC3", "...????.");
+            const size_t subMask = set.add<Sig::Mask::Eq<'.'>, Sig::Mask::BitMask<'m'>>("\x88\x99\xAA\x1B", "\x00\x00\x00\x1F", "...m");
+            const size_t bitmask = set.addBitmask("\x0A", "\x0F", 1);
+            const size_t unanchored = set.addBitmask("\x72\x72", "\xF0\xF0", 2);
+            const size_t missing = set.add("DE AD BE EF");
+
+            const size_t malformed = set.add("X");
+            const size_t unknownChar = set.add<Sig::Mask::Eq<'.'>>("\x01\x02", ".?");
+            const size_t noSubsig = set.add<Sig::Mask::Eq<'.'>, Sig::Mask::BitMask<'m'>>("\x01\x02", ".m");
+            sig_assert(malformed == Sig::PatternSet::k_invalidId);
+            sig_assert(unknownChar == Sig::PatternSet::k_invalidId);
+            sig_assert(noSubsig == Sig::PatternSet::k_invalidId);
+            sig_assert(set.count() == 6);
+
+            const void* results[6]{};
+            const size_t found = set.findFirst(g_arr, sizeof(g_arr), results);
+            sig_assert(found == 5);
+            sig_assert(results[oneLine] == &g_arr[4]);
+            sig_assert(results[mask] == &g_arr[56]);
+            sig_assert(results[subMask] == &g_arr[48]);
+            sig_assert(results[bitmask] == &g_arr[24]);
+            sig_assert(results[unanchored] == &g_arr[30]);
+            sig_assert(results[missing] == nullptr);
+
+            size_t matches[6]{};
+            const size_t count = set.scan(g_arr, sizeof(g_arr), [&set, &matches](const size_t id, const void* const pos)
+            {
+                sig_assert(Sig::find(pos, set.pattern(id).size, set.pattern(id)) == pos);
+                ++matches[id];
+            });
+            sig_assert(count == 12);
+            sig_assert(matches[bitmask] == 2);
+            sig_assert(matches[unanchored] == 7); // "rrrrrrtext": 5 pairs of 'r' + "rt" + "xt"
+
+            size_t visited = set.scan(g_arr, sizeof(g_arr), [](const size_t, const void*) -> bool
+            {
+                return false;
+            });
+            sig_assert(visited == 1);
+
+            visited = set.scan(g_arr, 0, [](const size_t, const void*) {});
+            sig_assert(visited == 0);
+
+            // Profiled scans find the same matches:
+            Sig::PatternSet::Profile profile;
+            visited = set.scan(g_arr, sizeof(g_arr), [](const size_t, const void*) {}, profile);
+            sig_assert(visited == count);
+            sig_assert(profile.patterns.size() == set.count());
+            sig_assert(profile.patterns[bitmask].matches == 2);
+            sig_assert(profile.patterns[unanchored].matches == 7);
+            sig_assert(profile.patterns[unanchored].candidates == sizeof(g_arr));
+            sig_assert(profile.patterns[missing].matches == 0);
+            sig_assert(profile.patterns[oneLine].falsePositiveRate() == 0.0);
+            sig_assert(profile.patterns[unanchored].falsePositiveRate() > 0.9);
+
+            double shares = 0.0;
+            unsigned long long comparedBytes = 0;
+            for (size_t id = 0; id < set.count(); ++id)
+            {
+                sig_assert(profile.patterns[id].candidates >= profile.patterns[id].matches);
+                sig_assert(profile.patterns[id].comparedBytes == (profile.patterns[id].candidates * set.pattern(id).size));
+                comparedBytes += profile.patterns[id].comparedBytes;
+                shares += profile.share(id);
+            }
+            sig_assert(comparedBytes == profile.comparedBytes);
+            sig_assert((shares > 0.999) && (shares < 1.001));
+            sig_assert(profile.share(unanchored) > profile.share(oneLine));
+
+            // Patterns without exact bytes are verified at every position, the missing one has bytes absent from the sample:
+            const auto estimates = set.analyze(g_arr, sizeof(g_arr));
+            sig_assert(estimates.size() == set.count());
+            sig_assert(estimates[unanchored].candidatesPerMiB == 1024.0 * 1024.0);
+            sig_assert(estimates[bitmask].candidatesPerMiB > estimates[oneLine].candidatesPerMiB);
+            sig_assert(estimates[missing].candidatesPerMiB == 0.0);
+            sig_assert(estimates[missing].matchesPerMiB == 0.0);
+            sig_assert(estimates[oneLine].matchesPerMiB > 0.0);
+            sig_assert(estimates[bitmask].sample.matches == 2);
+        }
+    }
+
+    namespace ParallelTests
+    {
+        void runTests()
+        {
+            // Chunks of 16 bytes overlapping by 3 bytes on 4 threads:
+            Sig::Parallel parallel(4, 16);
+            sig_assert(parallel.threads() == 4);
+
+            unsigned char buf[1000]{};
+            buf[31] = 0x11; buf[32] = 0x22; buf[33] = 0x33; buf[34] = 0x44; // Crosses the chunk boundary
+            buf[700] = 0x11; buf[701] = 0x22; buf[702] = 0x33; buf[703] = 0x44;
+
+            const void* found = parallel.find<Sig::Dword<0x44332211>>(buf, sizeof(buf));
+            sig_assert(found == &buf[31]);
+
+            found = parallel.find(buf, sizeof(buf), "11 22 ? 44");
+            sig_assert(found == &buf[31]);
+
+            found = parallel.find<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>(buf, sizeof(buf), "\x11\x22\x00\x44", "..?.");
+            sig_assert(found == &buf[31]);
+
+            found = parallel.bitmask(buf, sizeof(buf), "\x11\x22", "\xFF\xFF", 2);
+            sig_assert(found == &buf[31]);
+
+            buf[32] = 0;
+            found = parallel.find(buf, sizeof(buf), "11 22 ? 44");
+            sig_assert(found == &buf[700]);
+
+            buf[998] = 0x55; buf[999] = 0x66;
+            found = parallel.find(buf, sizeof(buf), "55 66");
+            sig_assert(found == &buf[998]);
+
+            found = parallel.find(buf, sizeof(buf), "55 66 77");
+            sig_assert(found == nullptr);
+
+            const Sig::Pattern pattern("66");
+            found = parallel.find(buf, sizeof(buf), pattern);
+            sig_assert(found == &buf[999]);
+
+            // Concurrent scans on the same pool are serialized:
+            std::thread other([&parallel, &buf]()
+            {
+                for (size_t i = 0; i < 100; ++i)
+                {
+                    const void* const match = parallel.find<Sig::Byte<0x55>>(buf, sizeof(buf));
+                    sig_assert(match == &buf[998]);
+                }
+            });
+
+            for (size_t i = 0; i < 100; ++i)
+            {
+                const void* const match = parallel.find<Sig::Byte<0x11>>(buf, sizeof(buf));
+                sig_assert(match == &buf[31]);
+            }
+
+            other.join();
+
+            Sig::Parallel single(1, 16);
+            found = single.find(buf, sizeof(buf), "11 22 33 44");
+            sig_assert(found == &buf[700]);
+        }
+    }
+
+    namespace StreamTests
+    {
+        void runTests()
+        {
+            const unsigned char data[]{ 0x11, 0x22, 0x33, 0x44, 0x00, 0x11, 0x22, 0x33, 0x44, 0x11, 0x22 };
+
+            unsigned long long offsets[4]{};
+            size_t count = 0;
+            const auto collect = [&offsets, &count](const unsigned long long offset)
+            {
+                offsets[count++] = offset;
+            };
+
+            // Matches that cross the chunk boundaries:
+            Sig::Stream stream(Sig::Pattern("11 22 ? 44"));
+            stream.feed(data, 2, collect);
+            stream.feed(data + 2, 1, collect);
+            stream.feed(data + 3, 5, collect);
+            stream.feed(data + 8, sizeof(data) - 8, collect);
+            sig_assert(stream.finish() == 2);
+            sig_assert(count == 2);
+            sig_assert((offsets[0] == 0) && (offsets[1] == 5));
+            sig_assert(stream.offset() == 0);
+
+            // The stream continues with absolute offsets:
+            count = 0;
+            stream.feed(data, sizeof(data), collect);
+            stream.feed(data, sizeof(data), collect);
+            sig_assert(count == 4);
+            sig_assert((offsets[2] == 11) && (offsets[3] == 16));
+            sig_assert(stream.offset() == 2 * sizeof(data));
+            stream.reset();
+
+            // Template patterns with sets need the size of the largest entry:
+            Sig::Stream set(Sig::TemplateSearcher<Sig::Byte<0x11>, Sig::Set<Sig::Byte<0x22>, Sig::Word<0x3322>>>{});
+            size_t visited = set.feed(data, 6, [](unsigned long long) {});
+            sig_assert(visited == 1);
+            visited = set.feed(data + 6, sizeof(data) - 6, [](const unsigned long long offset)
+            {
+                sig_assert(offset == 5);
+            });
+            sig_assert(visited == 1);
+            sig_assert(set.finish() == 2);
+
+            // The visitor stops the stream:
+            Sig::Stream mask(Sig::MaskSearcher<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>{ "\x22\x00", nullptr, ".?", 2 });
+            visited = mask.feed(data, sizeof(data), [](unsigned long long) -> bool
+            {
+                return false;
+            });
+            sig_assert(visited == 1);
+            sig_assert(mask.stopped());
+            visited = mask.feed(data, sizeof(data), [](unsigned long long) {});
+            sig_assert(visited == 0);
+        }
+    }
+
+    namespace FileTests
+    {
+        void runTests()
+        {
+            const char* const path = "Sig.File.test";
+
+            // Three windows of the smallest size with matches on their boundaries:
+            const Sig::File::Options options{ 1, false };
+            const size_t window = Sig::File(path, options).window();
+
+            std::vector<unsigned char> content(window * 3 + 100, 0xCC);
+            const size_t offsets[]{ 10, window - 2, window * 2 - 1, window * 3 + 96 };
+            for (const size_t offset : offsets)
+            {
+                content[offset] = 0x11;
+                content[offset + 1] = 0x22;
+                content[offset + 2] = 0x33;
+                content[offset + 3] = 0x44;
+            }
+
+            {
+                std::ofstream stream(path, std::ios::binary);
+                stream.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+            }
+
+            {
+                const Sig::File file(path, options);
+                sig_assert(file.valid());
+                sig_assert(file.size() == content.size());
+
+                sig_assert(file.find("11 22 ? 44") == 10);
+                sig_assert(file.find<Sig::Dword<0x44332211>>() == 10);
+                const unsigned long long masked = file.find<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>("\x11\x22\x00\x44", "..?.");
+                sig_assert(masked == 10);
+                sig_assert(file.bitmask("\x11\x22", "\xFF\xFF", 2) == 10);
+                sig_assert(file.find("11 22 33 55") == Sig::File::k_notFound);
+
+                size_t index = 0;
+                const size_t count = file.findAll(Sig::Pattern("11 22 33 44"), [&index, &offsets](const unsigned long long offset)
+                {
+                    sig_assert(offset == offsets[index++]);
+                });
+                sig_assert(count == 4);
+            }
+
+            sig_assert(!Sig::File("Sig.File.missing").valid());
+
+            std::remove(path);
+        }
+    }
+
+#ifdef __linux__
+    namespace ProcessTests
+    {
+        void runTests()
+        {
+            // Chunks of a page to cross the chunk boundaries:
+            Sig::Process process(getpid(), 4096);
+            sig_assert(process.valid());
+            sig_assert(!process.regions().empty());
+
+            // A separate mapping as the heap may be a huge region under sanitizers:
+            auto* const mapping = static_cast<unsigned char*>(mmap(nullptr, 3 * 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            sig_assert(mapping != MAP_FAILED);
+            memset(mapping, 0xCC, 3 * 4096);
+
+            const size_t offsets[]{ 4094, 8190 };
+            for (const size_t offset : offsets)
+            {
+                mapping[offset] = 0x5A;
+                mapping[offset + 1] = 0xA5;
+                mapping[offset + 2] = 0x3C;
+                mapping[offset + 3] = 0xC3;
+            }
+
+            sig_assert(process.refresh());
+
+            // Only the region of the buffer is scanned as the pattern itself lives somewhere in the memory too:
+            const auto buffer = [mapping](const Sig::Process::Region& region) -> bool
+            {
+                const auto address = reinterpret_cast<uintptr_t>(mapping);
+                return (region.begin <= address) && (address < region.end);
+            };
+
+            size_t found = 0;
+            const size_t count = process.findAll(Sig::TemplateSearcher<Sig::Dword<0xC33CA55A>>{}, [mapping, &found, &offsets](const unsigned long long address)
+            {
+                for (const size_t offset : offsets)
+                {
+                    found += (address == reinterpret_cast<uintptr_t>(&mapping[offset])) ? 1 : 0;
+                }
+            }, buffer);
+            sig_assert(count == 2);
+            sig_assert(found == 2);
+
+            const unsigned long long missing = process.find(Sig::TemplateSearcher<Sig::Dword<0xC33CA55A>>{}, Sig::Process::Filter{ Sig::Process::k_write, "Sig.missing" });
+            sig_assert(missing == Sig::Process::k_notFound);
+
+            sig_assert(!Sig::Process(-1).valid());
+
+            munmap(mapping, 3 * 4096);
+
+            // A process that has exited stops the scan instead of reading it page by page:
+            const pid_t child = fork();
+            if (!child)
+            {
+                pause();
+                _exit(0);
+            }
+
+            Sig::Process exited(child);
+            sig_assert(exited.valid());
+            kill(child, SIGKILL);
+            waitpid(child, nullptr, 0);
+
+            sig_assert(exited.find("5A A5 3C C3") == Sig::Process::k_notFound);
+            sig_assert(!exited.valid());
+        }
+    }
+#endif
+
+    namespace ElfTests
+    {
+        void put(std::vector<unsigned char>& image, const size_t offset, const unsigned long long value, const size_t size)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                image[offset + i] = static_cast<unsigned char>(value >> (i * 8));
+            }
+        }
+
+        // ELF64 with the executable .text and the writable .data, both are loadable:
+        std::vector<unsigned char> makeImage()
+        {
+            std::vector<unsigned char> image(0x300, 0);
+            put(image, 0, 0x010102464C457Full, 8); // "\x7FELF", ELFCLASS64, ELFDATA2LSB, EV_CURRENT
+            put(image, 16, 3, 2);       // ET_DYN
+            put(image, 32, 0x40, 8);    // e_phoff
+            put(image, 40, 0x200, 8);   // e_shoff
+            put(image, 54, 56, 2);      // e_phentsize
+            put(image, 56, 2, 2);       // e_phnum
+            put(image, 58, 64, 2);      // e_shentsize
+            put(image, 60, 4, 2);       // e_shnum
+            put(image, 62, 3, 2);       // e_shstrndx
+
+            const unsigned long long segments[][4]{ { 5, 0x100, 0x401100, 0x40 }, { 6, 0x140, 0x402140, 0x40 } };
+            for (size_t i = 0; i < 2; ++i)
+            {
+                const size_t phdr = 0x40 + i * 56;
+                put(image, phdr, 1, 4);                     // PT_LOAD
+                put(image, phdr + 4, segments[i][0], 4);    // p_flags
+                put(image, phdr + 8, segments[i][1], 8);    // p_offset
+                put(image, phdr + 16, segments[i][2], 8);   // p_vaddr
+                put(image, phdr + 32, segments[i][3], 8);   // p_filesz
+                put(image, phdr + 40, segments[i][3], 8);   // p_memsz
+            }
+
+            const char names[] = "\0.text\0.data\0.shstrtab";
+            memcpy(&image[0x180], names, sizeof(names));
+
+            const unsigned long long sections[][5]{ { 1, 1, 0x401100, 0x100, 0x40 }, { 7, 1, 0x402140, 0x140, 0x40 }, { 13, 3, 0, 0x180, sizeof(names) } };
+            for (size_t i = 0; i < 3; ++i)
+            {
+                const size_t shdr = 0x200 + (i + 1) * 64;
+                put(image, shdr, sections[i][0], 4);        // sh_name
+                put(image, shdr + 4, sections[i][1], 4);    // sh_type
+                put(image, shdr + 16, sections[i][2], 8);   // sh_addr
+                put(image, shdr + 24, sections[i][3], 8);   // sh_offset
+                put(image, shdr + 32, sections[i][4], 8);   // sh_size
+            }
+
+            // The pattern in .text, .data and outside of sections:
+            for (const size_t offset : { 0x110, 0x150, 0x1C0 })
+            {
+                put(image, offset, 0x44332211, 4);
+            }
+
+            return image;
+        }
+
+        void checkImage(const Sig::Elf& elf)
+        {
+            sig_assert(elf.valid());
+            sig_assert(elf.is64());
+            sig_assert(elf.type() == Sig::Elf::k_shared);
+            sig_assert(elf.programHeaders().size() == 2);
+            sig_assert(elf.sectionHeaders().size() == 4);
+            sig_assert(elf.sectionHeaders()[1].name == ".text");
+
+            sig_assert(elf.find("11 22 ? 44", elf.sections(".text")) == 0x401110);
+            sig_assert(elf.find("11 22 ? 44", elf.sections(".data")) == 0x402150);
+            sig_assert(elf.find("11 22 ? 44", elf.sections(".bss")) == Sig::Elf::k_notFound);
+            sig_assert(elf.find("11 22 ? 44", elf.segments(Sig::Elf::k_exec)) == 0x401110);
+            sig_assert(elf.find("11 22 ? 44", elf.segments(Sig::Elf::k_write)) == 0x402150);
+
+            unsigned long long addresses[2]{};
+            size_t index = 0;
+            const size_t count = elf.findAll(Sig::TemplateSearcher<Sig::Dword<0x44332211>>{}, elf.sections(".text", ".data"), [&addresses, &index](const unsigned long long address)
+            {
+                addresses[index++] = address;
+            });
+            sig_assert(count == 2);
+            sig_assert((addresses[0] == 0x401110) && (addresses[1] == 0x402150));
+        }
+
+        void runTests()
+        {
+            const auto image = makeImage();
+            checkImage(Sig::Elf(image.data(), image.size()));
+
+            const char* const path = "Sig.Elf.test";
+
+            {
+                std::ofstream stream(path, std::ios::binary);
+                stream.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+            }
+
+            {
+                const Sig::File file(path);
+                checkImage(Sig::Elf(file));
+            }
+
+            std::remove(path);
+
+            sig_assert(!Sig::Elf(g_arr, sizeof(g_arr)).valid());
+
+            // Untrusted counts and sizes that don't fit into the image:
+            const auto malformed = [&image](const size_t offset, const unsigned long long value, const size_t size) -> bool
+            {
+                auto copy = image;
+                put(copy, offset, value, size);
+                return !Sig::Elf(copy.data(), copy.size()).valid();
+            };
+
+            sig_assert(malformed(56, 100, 2));                      // e_phnum
+            sig_assert(malformed(60, 100, 2));                      // e_shnum
+            sig_assert(malformed(40, 0x2F0, 8));                    // e_shoff near the end
+            sig_assert(malformed(0x200 + 3 * 64 + 32, 1ull << 40, 8)); // sh_size of .shstrtab
+
+            // Counts in the first section header (e_shnum == 0 and e_phnum == PN_XNUM) that overflow the size of the table:
+            auto extended = image;
+            put(extended, 60, 0, 2);
+            for (const unsigned long long count : { 1ull << 58, 1ull << 44 })
+            {
+                put(extended, 0x200 + 32, count, 8);
+                sig_assert(!Sig::Elf(extended.data(), extended.size()).valid());
+            }
+
+            extended = image;
+            put(extended, 56, 0xFFFF, 2);
+            put(extended, 0x200 + 44, 0xFFFFFFFF, 4);
+            sig_assert(!Sig::Elf(extended.data(), extended.size()).valid());
+
+            // Tables cut off by the end of the image:
+            sig_assert(!Sig::Elf(image.data(), 0x250).valid());
+            sig_assert(!Sig::Elf(image.data(), 0x60).valid());
+            sig_assert(Sig::Elf(image.data(), image.size()).buildId().empty());
+
+            // The build-id note in a PT_NOTE segment:
+            auto noted = image;
+            put(noted, 56, 3, 2);           // e_phnum
+            put(noted, 0xB0, 4, 4);         // PT_NOTE
+            put(noted, 0xB0 + 8, 0x1D0, 8); // p_offset
+            put(noted, 0xB0 + 32, 28, 8);   // p_filesz
+            put(noted, 0x1D0, 4, 4);        // n_namesz
+            put(noted, 0x1D4, 8, 4);        // n_descsz
+            put(noted, 0x1D8, 3, 4);        // NT_GNU_BUILD_ID
+            memcpy(&noted[0x1DC], "GNU", 4);
+            put(noted, 0x1E0, 0x0123456789ABCDEFull, 8);
+
+            const auto buildId = Sig::Elf(noted.data(), noted.size()).buildId();
+            sig_assert(buildId.size() == 8);
+            sig_assert((buildId[0] == 0xEF) && (buildId[7] == 0x01));
+        }
+    }
+
+    namespace CacheTests
+    {
+        void runTests()
+        {
+            const char* const path = "Sig.Cache.test";
+            std::remove(path);
+
+            const unsigned long long module = Sig::Cache::hash(g_arr, sizeof(g_arr));
+            sig_assert(module != Sig::Cache::hash(g_arr, sizeof(g_arr) - 1));
+            sig_assert(Sig::Cache::hash(Sig::FixedPattern<4>("1D 1E ? 72")) != Sig::Cache::hash(Sig::FixedPattern<4>("1D 1E 1F 72")));
+
+            {
+                Sig::Cache cache(path);
+                sig_assert(cache.count() == 0);
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "1D 1E ? 72") == &g_arr[27]);
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "DE AD") == nullptr);
+                sig_assert(cache.count() == 2);
+                sig_assert(cache.save());
+            }
+
+            {
+                // Hits and misses are returned from the file:
+                Sig::Cache cache(path);
+                sig_assert(cache.count() == 2);
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "1D 1E ? 72") == &g_arr[27]);
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "DE AD") == nullptr);
+                sig_assert(cache.count() == 2);
+
+                // Regions of another size are other keys:
+                sig_assert(cache.find(g_arr, 20, module, "1D 1E ? 72") == nullptr);
+                sig_assert(cache.count() == 3);
+
+                // Stale hits are found again:
+                unsigned char changed[sizeof(g_arr)]{};
+                memcpy(changed, g_arr, sizeof(g_arr));
+                changed[28] = 0;
+                changed[50] = 0x1D; changed[51] = 0x1E; changed[53] = 0x72;
+                sig_assert(cache.find(changed, sizeof(changed), module, "1D 1E ? 72") == &changed[50]);
+                sig_assert(cache.count() == 3);
+                sig_assert(cache.save());
+            }
+
+            {
+                Sig::Cache cache(path);
+                sig_assert(cache.count() == 3);
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "1D 1E ? 72") == &g_arr[27]);
+            }
+
+            // Torn files (records that don't match the checksum) are empty caches:
+            {
+                std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+                stream.seekp(-1, std::ios::end);
+                stream.put('\x5A');
+            }
+
+            sig_assert(Sig::Cache(path).count() == 0);
+
+            // Two caches saving at once write their own temporary files:
+            {
+                Sig::Cache first(path);
+                Sig::Cache second(path);
+                sig_assert(first.find(g_arr, sizeof(g_arr), module, "1D 1E ? 72") == &g_arr[27]);
+                sig_assert(second.find(g_arr, sizeof(g_arr), module, "DE AD") == nullptr);
+                sig_assert(first.save() && second.save());
+            }
+
+            sig_assert(Sig::Cache(path).count() == 1);
+
+            // Foreign files are empty caches:
+            {
+                std::ofstream stream(path, std::ios::binary);
+                stream.write(reinterpret_cast<const char*>(g_arr), static_cast<std::streamsize>(sizeof(g_arr)));
+            }
+
+            sig_assert(Sig::Cache(path).count() == 0);
+
+            std::remove(path);
         }
     }
 
     void runTests()
     {
-        TemplateTests::runTests();
-        MaskTests::runTests();
-        BitmaskTests::runTests();
-        OneLineTests::runTests();
+        // Kernels of every instruction set that the CPU supports:
+        const auto isa = Sig::isa();
+        sig_assert(Sig::setIsa(Sig::Isa::scalar));
+        sig_assert(Sig::isa() == Sig::Isa::scalar);
+
+        for (const auto kernels : { Sig::Isa::scalar, Sig::Isa::sse2, Sig::Isa::avx2, Sig::Isa::avx512, Sig::Isa::neon })
+        {
+            if (!Sig::setIsa(kernels))
+            {
+                sig_assert(Sig::isa() != kernels);
+                continue;
+            }
+
+            TemplateTests::runTests();
+            MaskTests::runTests();
+            BitmaskTests::runTests();
+            OneLineTests::runTests();
+            CompiledTests::runTests();
+        }
+
+        sig_assert(Sig::setIsa(isa));
+
+        FindAllTests::runTests();
+        PatternSetTests::runTests();
+        ParallelTests::runTests();
+        StreamTests::runTests();
+        FileTests::runTests();
+        ElfTests::runTests();
+        CacheTests::runTests();
+#ifdef __linux__
+        ProcessTests::runTests();
+#endif
     }
 }
 
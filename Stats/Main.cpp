@@ -0,0 +1,171 @@
+﻿// Scans counted by Sig::Stats: SIG_STATS changes the scans themselves, so they are tested apart from Sig/Main.cpp
+#define SIG_STATS
+
+#include <Sig/Sig.hpp>
+#include <Sig/Perf.hpp>
+#include <Sig/Cache.hpp>
+
+#include <intrin.h>
+
+#include <cstdio>
+#include <cstring>
+
+#define sig_assert(cond) if (!(cond)) { __int2c(); }
+
+
+namespace
+{
+    const unsigned char g_arr[]
+    {
+        /* 00 */ '?', '?', '?', '?',
+        /* 04 */ 1, 2, 2, 3, 3, 3, 4, 4, 4, 4,
+        /* 14 */ 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+        /* 24 */ 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+        /* 30 */ 'r', 'r', 'r', 'r', 'r', 'r',
+        /* 36 */ 't', 'e', 'x', 't',
+        /* 40 */ 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+        /* 48 */ 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF,
+        /* 56 */ 0x0F, 0x05, 0xE9, '?', '?', '?', '?', 0xC3,
+        /* 64 */ 't', 0x00, 'e', 0x00, 'x', 0x00, 't', 0x00
+    };
+
+    namespace StatsTests
+    {
+        struct CountingHook : Sig::Stats::Hook
+        {
+            size_t begins = 0;
+            size_t ends = 0;
+
+            void begin() override
+            {
+                ++begins;
+            }
+
+            void end(Sig::Stats::Counters& scan) override
+            {
+                ++ends;
+                scan.cycles = 42;
+            }
+        };
+
+        void runTests()
+        {
+            Sig::Stats::reset();
+
+            const void* found = Sig::find<Sig::Byte<0x1D, 0x1E>>(g_arr, sizeof(g_arr));
+            sig_assert(found == &g_arr[27]);
+
+            const auto& scan = Sig::Stats::last();
+            sig_assert(scan.scans == 1);
+            sig_assert(scan.bytes == sizeof(g_arr));
+            sig_assert(scan.positions == (sizeof(g_arr) - 1));
+            sig_assert((scan.candidates >= 1) && (scan.candidates <= scan.positions));
+            sig_assert(scan.comparisons >= scan.candidates);
+            sig_assert((scan.hitRate() > 0.0) && (scan.hitRate() <= 1.0));
+
+            // The mask is lowered and searched by Sig::bitmask inside the same scan:
+            found = Sig::find<Sig::Mask::Eq<'.'>, Sig::Mask::Any<'?'>>(g_arr, sizeof(g_arr), "\x1D\x00\x1F", ".?.");
+            sig_assert(found == &g_arr[27]);
+            sig_assert(Sig::Stats::last().scans == 1);
+            sig_assert(Sig::Stats::last().positions == (sizeof(g_arr) - 2));
+            sig_assert(Sig::Stats::total().scans == 2);
+
+            // Every comparator of the program is counted:
+            found = Sig::find<Sig::Mask::Eq<'.'>, Sig::Mask::NotEq<'!'>>(g_arr, sizeof(g_arr), "\x1D\x00\x1F", ".!.");
+            sig_assert(found == &g_arr[27]);
+            sig_assert(Sig::Stats::last().comparisons >= 3);
+            sig_assert(Sig::Stats::last().comparisonsPerCandidate() >= 1.0);
+
+            CountingHook hook;
+            Sig::Stats::setHook(&hook);
+            found = Sig::find(g_arr, sizeof(g_arr), "1D 1E ? 72");
+            Sig::Stats::setHook(nullptr);
+            sig_assert(found == &g_arr[27]);
+            sig_assert((hook.begins == 1) && (hook.ends == 1));
+            sig_assert(Sig::Stats::last().cycles == 42);
+            sig_assert(Sig::Stats::total().scans == 4);
+            sig_assert(Sig::Stats::total().cycles == 42);
+
+#ifdef __linux__
+            // Hardware counters may be unavailable in VMs and containers:
+            Sig::Perf perf;
+            if (perf.valid())
+            {
+                Sig::Stats::setHook(&perf);
+                found = Sig::find(g_arr, sizeof(g_arr), "1D 1E ? 72");
+                Sig::Stats::setHook(nullptr);
+                sig_assert(found == &g_arr[27]);
+                sig_assert(Sig::Stats::last().cycles != 0);
+            }
+#endif
+
+            Sig::Stats::reset();
+            sig_assert(Sig::Stats::total().scans == 0);
+        }
+    }
+
+    namespace CacheTests
+    {
+        void runTests()
+        {
+            const char* const path = "Sig.Cache.stats.test";
+            std::remove(path);
+
+            const unsigned long long module = Sig::Cache::hash(g_arr, sizeof(g_arr));
+
+            {
+                Sig::Cache cache(path);
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "1D 1E ? 72") == &g_arr[27]);
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "DE AD") == nullptr);
+                sig_assert(cache.save());
+            }
+
+            {
+                // Hits and misses are returned without scanning:
+                Sig::Cache cache(path);
+
+                Sig::Stats::reset();
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "1D 1E ? 72") == &g_arr[27]);
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "DE AD") == nullptr);
+                sig_assert(Sig::Stats::total().scans == 0);
+
+                // Regions of another size are other keys:
+                sig_assert(cache.find(g_arr, 20, module, "1D 1E ? 72") == nullptr);
+                sig_assert(Sig::Stats::total().scans == 1);
+
+                // Stale hits are found again:
+                unsigned char changed[sizeof(g_arr)]{};
+                memcpy(changed, g_arr, sizeof(g_arr));
+                changed[28] = 0;
+                changed[50] = 0x1D; changed[51] = 0x1E; changed[53] = 0x72;
+                sig_assert(cache.find(changed, sizeof(changed), module, "1D 1E ? 72") == &changed[50]);
+                sig_assert(Sig::Stats::total().scans == 2);
+                sig_assert(cache.save());
+            }
+
+            {
+                // The hit is replaced by the stale one, so the original buffer is scanned again:
+                Sig::Cache cache(path);
+
+                Sig::Stats::reset();
+                sig_assert(cache.find(g_arr, sizeof(g_arr), module, "1D 1E ? 72") == &g_arr[27]);
+                sig_assert(Sig::Stats::total().scans == 1);
+            }
+
+            Sig::Stats::reset();
+            std::remove(path);
+        }
+    }
+
+    void runTests()
+    {
+        StatsTests::runTests();
+        CacheTests::runTests();
+    }
+}
+
+int main()
+{
+    runTests();
+    return 0;
+}
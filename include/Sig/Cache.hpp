@@ -0,0 +1,484 @@
+#pragma once
+
+#include "Sig.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Persisted results of scans of unchanged images: the first match of a pattern is remembered by the key
+// of the scanned region (a hash of its bytes or of its identity, e.g. Sig::Elf::buildId()), the hash
+// of the compiled pattern and the size of the region. The file is a sorted array of records that is mapped
+// and searched in place, so a repeated find costs a binary search and a comparison of the matched bytes
+// instead of a scan. Matches are confirmed by their bytes, cached misses are trusted to the key of the region.
+// The file has the byte order of the machine and a checksum of the records. Not thread-safe, but processes
+// may save the same cache at once: each of them writes its own temporary file and the last one replaces the cache.
+//
+//   Sig::Cache cache("patterns.cache");
+//   const auto id = elf.buildId();
+//   const unsigned long long module = Sig::Cache::hash(id.data(), id.size());
+//   const void* const found = cache.find(text, textSize, module, "48 8B ? ? 89 05");
+//   cache.save();
+struct Sig::Cache
+{
+    explicit Cache(const char* const path) : m_path(path)
+    {
+        map();
+    }
+
+    Cache(const Cache&) = delete;
+    Cache& operator = (const Cache&) = delete;
+
+    ~Cache()
+    {
+        unmap();
+    }
+
+    // Records in the file and the new ones that aren't saved yet:
+    size_t count() const
+    {
+        size_t count = m_added.size();
+        for (size_t i = 0; i < m_count; ++i)
+        {
+            if (!findRecord(m_added.data(), m_added.data() + m_added.size(), m_records[i]))
+            {
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    // Key of the region by its bytes (one pass over them) or by its identity (e.g. Sig::Elf::buildId()):
+    static unsigned long long hash(const void* const data, const size_t size)
+    {
+        const auto* const bytes = static_cast<const unsigned char*>(data);
+
+        // Four independent lanes of eight bytes:
+        unsigned long long lanes[4]{ size, size ^ k_prime, ~size, ~size ^ k_prime };
+        size_t pos = 0;
+        for (; (pos + sizeof(lanes)) <= size; pos += sizeof(lanes))
+        {
+            for (size_t lane = 0; lane < 4; ++lane)
+            {
+                unsigned long long word = 0;
+                memcpy(&word, bytes + pos + lane * sizeof(word), sizeof(word));
+                lanes[lane] = mix(lanes[lane] ^ word);
+            }
+        }
+
+        unsigned long long result = mix(lanes[0] ^ mix(lanes[1] ^ mix(lanes[2] ^ mix(lanes[3]))));
+        for (; pos < size; ++pos)
+        {
+            result = mix(result ^ bytes[pos]);
+        }
+
+        return result;
+    }
+
+    // Key of the compiled pattern (Sig::Pattern, Sig::FixedPattern<capacity> or Sig::PatternView), wildcard bits don't change it:
+    static unsigned long long hash(const PatternView& pattern)
+    {
+        unsigned long long result = mix(pattern.size);
+        for (size_t i = 0; i < pattern.size; ++i)
+        {
+            result = mix(result ^ ((pattern.val[i] & pattern.msk[i]) | (static_cast<unsigned long long>(pattern.msk[i]) << 8)));
+        }
+
+        return result;
+    }
+
+    // Returns the first match in the region of the module: the cached one if its bytes still match the pattern,
+    // otherwise the region is scanned and the result is remembered until the next save():
+    const void* find(const void* const buf, const size_t size, const unsigned long long module, const PatternView& pattern)
+    {
+        const Record key{ module, hash(pattern), size, k_notFound };
+        const Record* const cached = lookup(key);
+        if (cached)
+        {
+            if (cached->offset == k_notFound)
+            {
+                return nullptr;
+            }
+
+            if ((cached->offset <= size) && (pattern.size <= (size - cached->offset)))
+            {
+                const auto* const pos = static_cast<const unsigned char*>(buf) + cached->offset;
+                if (matches(pos, pattern))
+                {
+                    return pos;
+                }
+            }
+        }
+
+        const void* const found = pattern.find(buf, size);
+        remember(Record{ key.module, key.pattern, key.size, found ? static_cast<unsigned long long>(static_cast<const unsigned char*>(found) - static_cast<const unsigned char*>(buf)) : k_notFound });
+        return found;
+    }
+
+    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF"
+    const void* find(const void* const buf, const size_t size, const unsigned long long module, const char* const sig)
+    {
+        const FixedPattern<k_inlinePatternCapacity> inlined(sig);
+        if (inlined.valid())
+        {
+            return find(buf, size, module, inlined);
+        }
+
+        const Pattern pattern(sig);
+        return pattern.valid() ? find(buf, size, module, pattern) : nullptr;
+    }
+
+    // Writes the records into a temporary file that replaces the cache, returns false if it can't be written:
+    bool save()
+    {
+        if (m_added.empty())
+        {
+            return true;
+        }
+
+        std::vector<Record> records;
+        records.reserve(m_count + m_added.size());
+        std::merge(m_added.begin(), m_added.end(), m_records, m_records + m_count, std::back_inserter(records), &less);
+
+        // The new records are merged first, so they replace the old ones with the same keys:
+        records.erase(std::unique(records.begin(), records.end(), [](const Record& left, const Record& right) -> bool
+        {
+            return !less(left, right) && !less(right, left);
+        }), records.end());
+
+        Header header{};
+        memcpy(header.magic, k_magic, sizeof(header.magic));
+        header.version = k_version;
+        header.count = records.size();
+        header.checksum = hash(records.data(), records.size() * sizeof(Record));
+
+        // Processes that save the same cache at once write their own temporary files, the last rename wins:
+        std::string temporary;
+        if (!write(m_path, header, records, temporary))
+        {
+            return false;
+        }
+
+        // The mapping keeps the old file busy on Windows:
+        unmap();
+        const bool replaced = replace(temporary.c_str(), m_path.c_str());
+        map();
+
+        if (replaced)
+        {
+            m_added.clear();
+        }
+
+        return replaced;
+    }
+
+private:
+    static constexpr unsigned long long k_notFound = ~0ull;
+    static constexpr unsigned long long k_prime = 0x9E3779B97F4A7C15ull;
+    static constexpr char k_magic[8]{ 'S', 'i', 'g', 'C', 'a', 'c', 'h', 'e' };
+    static constexpr unsigned long long k_version = 2;
+
+    struct Header
+    {
+        char magic[8];
+        unsigned long long version;
+        unsigned long long count;
+        unsigned long long checksum; // Sig::Cache::hash of the records
+    };
+
+    struct Record
+    {
+        unsigned long long module;
+        unsigned long long pattern;
+        unsigned long long size;
+        unsigned long long offset; // Sig::Cache::k_notFound for cached misses
+    };
+
+    static unsigned long long mix(unsigned long long value)
+    {
+        value *= k_prime;
+        return value ^ (value >> 29);
+    }
+
+    // Only the matched bytes are compared, without a scan:
+    static bool matches(const unsigned char* const pos, const PatternView& pattern)
+    {
+        for (size_t i = 0; i < pattern.size; ++i)
+        {
+            if ((pos[i] & pattern.msk[i]) != (pattern.val[i] & pattern.msk[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static bool less(const Record& left, const Record& right)
+    {
+        if (left.module != right.module)
+        {
+            return left.module < right.module;
+        }
+
+        if (left.pattern != right.pattern)
+        {
+            return left.pattern < right.pattern;
+        }
+
+        return left.size < right.size;
+    }
+
+    static const Record* findRecord(const Record* const begin, const Record* const end, const Record& key)
+    {
+        const auto* const found = std::lower_bound(begin, end, key, &less);
+        return ((found != end) && !less(key, *found)) ? found : nullptr;
+    }
+
+    // The new records shadow the ones from the file:
+    const Record* lookup(const Record& key) const
+    {
+        const Record* const added = findRecord(m_added.data(), m_added.data() + m_added.size(), key);
+        return added ? added : findRecord(m_records, m_records + m_count, key);
+    }
+
+    void remember(const Record& record)
+    {
+        const auto pos = std::lower_bound(m_added.begin(), m_added.end(), record, &less);
+        if ((pos != m_added.end()) && !less(record, *pos))
+        {
+            *pos = record;
+        }
+        else
+        {
+            m_added.insert(pos, record);
+        }
+    }
+
+    // A missing, truncated, torn or foreign file is an empty cache:
+    void map()
+    {
+        size_t size = 0;
+        const auto* const view = mapFile(m_path.c_str(), size);
+        if (!view)
+        {
+            return;
+        }
+
+        m_view = view;
+        m_viewSize = size;
+
+        Header header{};
+        if (size < sizeof(header))
+        {
+            return;
+        }
+
+        memcpy(&header, view, sizeof(header));
+        if (memcmp(header.magic, k_magic, sizeof(header.magic)) || (header.version != k_version)
+            || (header.count > ((size - sizeof(header)) / sizeof(Record))) || ((sizeof(header) + header.count * sizeof(Record)) != size)
+            || (hash(view + sizeof(header), size - sizeof(header)) != header.checksum))
+        {
+            return;
+        }
+
+        m_records = reinterpret_cast<const Record*>(view + sizeof(header));
+        m_count = static_cast<size_t>(header.count);
+    }
+
+    void unmap()
+    {
+        if (m_view)
+        {
+            unmapFile(m_view, m_viewSize);
+        }
+
+        m_view = nullptr;
+        m_viewSize = 0;
+        m_records = nullptr;
+        m_count = 0;
+    }
+
+#ifdef _WIN32
+    static const unsigned char* mapFile(const char* const path, size_t& size)
+    {
+        const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        LARGE_INTEGER fileSize{};
+        const bool mappable = GetFileSizeEx(file, &fileSize) && (fileSize.QuadPart > 0) && (static_cast<unsigned long long>(fileSize.QuadPart) <= static_cast<size_t>(-1));
+        const HANDLE mapping = mappable ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        CloseHandle(file);
+        if (!mapping)
+        {
+            return nullptr;
+        }
+
+        // The view keeps the mapping alive:
+        const auto* const view = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+
+        size = view ? static_cast<size_t>(fileSize.QuadPart) : 0;
+        return view;
+    }
+
+    static void unmapFile(const unsigned char* const view, const size_t)
+    {
+        UnmapViewOfFile(view);
+    }
+
+    // Writes a new file next to the target and returns its name in the temporary:
+    static bool write(const std::string& target, const Header& header, const std::vector<Record>& records, std::string& temporary)
+    {
+        temporary = target + "." + std::to_string(GetCurrentProcessId()) + "." + std::to_string(GetCurrentThreadId()) + ".tmp";
+        const char* const path = temporary.c_str();
+        const HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        const auto put = [file](const void* const data, const size_t size) -> bool
+        {
+            const auto* const bytes = static_cast<const unsigned char*>(data);
+            for (size_t done = 0; done < size; )
+            {
+                const DWORD chunk = ((size - done) < 0x40000000) ? static_cast<DWORD>(size - done) : 0x40000000;
+                DWORD written = 0;
+                if (!WriteFile(file, bytes + done, chunk, &written, nullptr) || !written)
+                {
+                    return false;
+                }
+                done += written;
+            }
+            return true;
+        };
+
+        const bool written = put(&header, sizeof(header)) && put(records.data(), records.size() * sizeof(Record));
+        CloseHandle(file);
+        if (!written)
+        {
+            DeleteFileA(path);
+        }
+
+        return written;
+    }
+
+    static bool replace(const char* const from, const char* const to)
+    {
+        if (MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING))
+        {
+            return true;
+        }
+
+        DeleteFileA(from);
+        return false;
+    }
+#else
+    static const unsigned char* mapFile(const char* const path, size_t& size)
+    {
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+
+        struct stat info{};
+        const bool mappable = !fstat(fd, &info) && S_ISREG(info.st_mode) && (info.st_size > 0)
+            && (static_cast<unsigned long long>(info.st_size) <= static_cast<size_t>(-1));
+        void* const view = mappable ? mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (view == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        size = static_cast<size_t>(info.st_size);
+        return static_cast<const unsigned char*>(view);
+    }
+
+    static void unmapFile(const unsigned char* const view, const size_t size)
+    {
+        munmap(const_cast<unsigned char*>(view), size);
+    }
+
+    // Writes a new file next to the target and returns its name in the temporary:
+    static bool write(const std::string& target, const Header& header, const std::vector<Record>& records, std::string& temporary)
+    {
+        std::vector<char> name(target.begin(), target.end());
+        const char k_suffix[] = ".XXXXXX";
+        name.insert(name.end(), k_suffix, k_suffix + sizeof(k_suffix));
+
+        const int fd = mkstemp(name.data());
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        temporary = name.data();
+        const char* const path = temporary.c_str();
+
+        // mkstemp creates the file only for the owner:
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fchmod(fd, 0644);
+
+        const auto put = [fd](const void* const data, const size_t size) -> bool
+        {
+            const auto* const bytes = static_cast<const unsigned char*>(data);
+            for (size_t done = 0; done < size; )
+            {
+                const ssize_t written = ::write(fd, bytes + done, size - done);
+                if (written <= 0)
+                {
+                    return false;
+                }
+                done += static_cast<size_t>(written);
+            }
+            return true;
+        };
+
+        const bool written = put(&header, sizeof(header)) && put(records.data(), records.size() * sizeof(Record));
+        if (::close(fd) || !written)
+        {
+            unlink(path);
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool replace(const char* const from, const char* const to)
+    {
+        if (!rename(from, to))
+        {
+            return true;
+        }
+
+        unlink(from);
+        return false;
+    }
+#endif
+
+    std::string m_path;
+    std::vector<Record> m_added;    // Sorted by the keys
+    const unsigned char* m_view = nullptr;
+    size_t m_viewSize = 0;
+    const Record* m_records = nullptr;
+    size_t m_count = 0;
+};
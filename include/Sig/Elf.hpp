@@ -0,0 +1,482 @@
+#pragma once
+
+#include "Sig.hpp"
+#include "File.hpp"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+// Restricts scanning of ELF binaries and core dumps to the chosen sections or loadable segments.
+// Headers are parsed without any system or external headers (ELF32 and ELF64, little-endian),
+// the image is taken from the memory (e.g. a file that was read or mapped before) or from Sig::File.
+// Matches are reported by their virtual addresses.
+//
+//   const Sig::File file("/usr/lib/x86_64-linux-gnu/libc.so.6");
+//   const Sig::Elf elf(file);
+//   const unsigned long long address = elf.find("48 8B ? ? 89 05", elf.sections(".text"));
+struct Sig::Elf
+{
+    static constexpr unsigned long long k_notFound = ~0ull;
+
+    // Flags of segments (PF_X, PF_W and PF_R):
+    static constexpr unsigned int k_exec = 1;
+    static constexpr unsigned int k_write = 2;
+    static constexpr unsigned int k_read = 4;
+
+    // Types of files:
+    static constexpr unsigned short k_relocatable = 1;
+    static constexpr unsigned short k_executable = 2;
+    static constexpr unsigned short k_shared = 3;
+    static constexpr unsigned short k_core = 4;
+
+    struct Section
+    {
+        std::string name;
+        unsigned int type;          // SHT_*
+        unsigned long long flags;   // SHF_*
+        unsigned long long address;
+        unsigned long long offset;
+        unsigned long long size;
+    };
+
+    struct Segment
+    {
+        unsigned int type;          // PT_*
+        unsigned int flags;         // Sig::Elf::k_exec | k_write | k_read
+        unsigned long long offset;
+        unsigned long long address;
+        unsigned long long fileSize;
+        unsigned long long memorySize;
+    };
+
+    // Bytes of the image to scan and their virtual address:
+    struct Range
+    {
+        unsigned long long offset;
+        unsigned long long size;
+        unsigned long long address;
+    };
+
+    Elf(const void* const image, const size_t size) : m_image(static_cast<const unsigned char*>(image)), m_imageSize(size)
+    {
+        parse();
+    }
+
+    explicit Elf(const File& file) : m_file(&file), m_imageSize(file.size())
+    {
+        parse();
+    }
+
+    bool valid() const
+    {
+        return m_valid;
+    }
+
+    bool is64() const
+    {
+        return m_is64;
+    }
+
+    unsigned short type() const
+    {
+        return m_type;
+    }
+
+    const std::vector<Section>& sectionHeaders() const
+    {
+        return m_sections;
+    }
+
+    const std::vector<Segment>& programHeaders() const
+    {
+        return m_segments;
+    }
+
+    // Sections with the given names (e.g. ".text"), sections without data in the image are skipped:
+    template <typename... Names>
+    std::vector<Range> sections(const Names... names) const
+    {
+        std::vector<Range> ranges;
+        for (const auto& section : m_sections)
+        {
+            if ((section.type != k_sectionNoBits) && section.size && ((section.name == names) || ...))
+            {
+                ranges.push_back(Range{ section.offset, section.size, section.address });
+            }
+        }
+
+        return ranges;
+    }
+
+    // Loadable segments that have all of the flags (e.g. Sig::Elf::k_exec), the memory of segments
+    // that isn't stored in the image (.bss or pages that weren't dumped to the core) is skipped:
+    std::vector<Range> segments(const unsigned int flags) const
+    {
+        std::vector<Range> ranges;
+        for (const auto& segment : m_segments)
+        {
+            if ((segment.type == k_segmentLoad) && ((segment.flags & flags) == flags) && segment.fileSize)
+            {
+                ranges.push_back(Range{ segment.offset, segment.fileSize, segment.address });
+            }
+        }
+
+        return ranges;
+    }
+
+    // GNU build-id (NT_GNU_BUILD_ID) from the note sections or segments, empty if the binary has none.
+    // Identifies the binary without reading its code, e.g. as a key of Sig::Cache:
+    std::vector<unsigned char> buildId() const
+    {
+        std::vector<Range> notes;
+        for (const auto& section : m_sections)
+        {
+            if ((section.type == k_sectionNote) && section.size)
+            {
+                notes.push_back(Range{ section.offset, section.size, section.address });
+            }
+        }
+
+        for (const auto& segment : m_segments)
+        {
+            if ((segment.type == k_segmentNote) && segment.fileSize)
+            {
+                notes.push_back(Range{ segment.offset, segment.fileSize, segment.address });
+            }
+        }
+
+        // Every note is a header of three words, the name and the descriptor, both are aligned to four bytes:
+        std::vector<unsigned char> data;
+        for (const auto& note : notes)
+        {
+            if (!m_valid || (note.size > m_imageSize))
+            {
+                continue;
+            }
+
+            data.resize(static_cast<size_t>(note.size));
+            if (!read(note.offset, data.data(), data.size()))
+            {
+                continue;
+            }
+
+            for (unsigned long long pos = 0; (pos + 12) <= data.size(); )
+            {
+                const auto* const header = &data[static_cast<size_t>(pos)];
+                const unsigned long long nameSize = field(header, 0, 4);
+                const unsigned long long descSize = field(header, 4, 4);
+                const unsigned long long desc = pos + 12 + ((nameSize + 3) & ~3ull);
+                if ((desc > data.size()) || (descSize > (data.size() - desc)))
+                {
+                    break;
+                }
+
+                if ((field(header, 8, 4) == k_noteBuildId) && (nameSize == 4) && !memcmp(header + 12, "GNU", 4))
+                {
+                    const auto* const id = data.data() + static_cast<size_t>(desc);
+                    return std::vector<unsigned char>(id, id + static_cast<size_t>(descSize));
+                }
+
+                pos = desc + ((descSize + 3) & ~3ull);
+            }
+        }
+
+        return {};
+    }
+
+    // Any searcher: Sig::Pattern, Sig::FixedPattern<capacity>, Sig::TemplateSearcher<Entries...>, Sig::MaskSearcher<Comparators...>
+    // or a custom type with patternSize() and find(buf, size).
+    // Returns the virtual address of the first match in the first range that has it or Sig::Elf::k_notFound:
+    template <typename Searcher, typename = std::enable_if_t<std::is_class_v<Searcher>>>
+    unsigned long long find(const Searcher& searcher, const std::vector<Range>& ranges) const
+    {
+        unsigned long long result = k_notFound;
+        scan(searcher, ranges, [&result](const unsigned long long address) -> bool
+        {
+            result = address;
+            return false;
+        });
+
+        return result;
+    }
+
+    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF"
+    unsigned long long find(const char* const sig, const std::vector<Range>& ranges) const
+    {
+        const FixedPattern<k_inlinePatternCapacity> inlined(sig);
+        if (inlined.valid())
+        {
+            return find(inlined, ranges);
+        }
+
+        const Pattern pattern(sig);
+        return find(pattern, ranges);
+    }
+
+    // Calls the visitor for each match: bool visitor(unsigned long long address) returns false to stop,
+    // void visitor(unsigned long long address) visits all matches.
+    // Returns the count of visited matches:
+    template <typename Searcher, typename Visitor>
+    size_t findAll(const Searcher& searcher, const std::vector<Range>& ranges, Visitor&& visitor) const
+    {
+        return scan(searcher, ranges, [&visitor](const unsigned long long address) -> bool
+        {
+            if constexpr (std::is_void_v<decltype(visitor(address))>)
+            {
+                visitor(address);
+                return true;
+            }
+            else
+            {
+                return visitor(address);
+            }
+        });
+    }
+
+private:
+    static constexpr unsigned int k_sectionNoBits = 8;  // SHT_NOBITS
+    static constexpr unsigned int k_sectionNote = 7;    // SHT_NOTE
+    static constexpr unsigned int k_segmentLoad = 1;    // PT_LOAD
+    static constexpr unsigned int k_segmentNote = 4;    // PT_NOTE
+    static constexpr unsigned int k_noteBuildId = 3;    // NT_GNU_BUILD_ID
+    static constexpr unsigned short k_extendedCount = 0xFFFF; // PN_XNUM and SHN_XINDEX
+
+    template <typename Searcher, typename Visitor>
+    size_t scan(const Searcher& searcher, const std::vector<Range>& ranges, Visitor&& visitor) const
+    {
+        if (!m_valid)
+        {
+            return 0;
+        }
+
+        size_t count = 0;
+        bool proceed = true;
+        for (const auto& range : ranges)
+        {
+            if ((range.offset > m_imageSize) || (range.size > (m_imageSize - range.offset)))
+            {
+                continue;
+            }
+
+            const auto report = [&count, &proceed, &visitor, &range](const unsigned long long offset) -> bool
+            {
+                ++count;
+                proceed = visitor(range.address + (offset - range.offset));
+                return proceed;
+            };
+
+            if (m_file)
+            {
+                m_file->findAll(searcher, report, range.offset, range.offset + range.size);
+            }
+            else
+            {
+                const auto* const begin = m_image + range.offset;
+                const auto size = static_cast<size_t>(range.size);
+                for (const void* found = searcher.find(begin, size); found; )
+                {
+                    const auto pos = static_cast<size_t>(static_cast<const unsigned char*>(found) - begin);
+                    if (!report(range.offset + pos) || ((pos + 1) >= size))
+                    {
+                        break;
+                    }
+
+                    found = searcher.find(begin + pos + 1, size - pos - 1);
+                }
+            }
+
+            if (!proceed)
+            {
+                break;
+            }
+        }
+
+        return count;
+    }
+
+    bool read(const unsigned long long offset, void* const buf, const size_t size) const
+    {
+        if (m_file)
+        {
+            return m_file->read(offset, buf, size);
+        }
+
+        if ((offset > m_imageSize) || (size > (m_imageSize - offset)))
+        {
+            return false;
+        }
+
+        memcpy(buf, m_image + offset, size);
+        return true;
+    }
+
+    // Reads a little-endian field of the given size from the header:
+    static unsigned long long field(const unsigned char* const header, const size_t offset, const size_t size)
+    {
+        unsigned long long value = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            value |= static_cast<unsigned long long>(header[offset + i]) << (i * 8);
+        }
+
+        return value;
+    }
+
+    // Counts and sizes in the headers are untrusted, so tables are allocated only if they lie in the image:
+    bool fits(const unsigned long long offset, const unsigned long long count, const unsigned long long entrySize) const
+    {
+        return (offset <= m_imageSize) && (count <= ((m_imageSize - offset) / entrySize));
+    }
+
+    void parse()
+    {
+        unsigned char header[64]{};
+        if (!read(0, header, 52) || (header[0] != 0x7F) || (header[1] != 'E') || (header[2] != 'L') || (header[3] != 'F'))
+        {
+            return;
+        }
+
+        // Only little-endian images are supported:
+        if (header[5] != 1)
+        {
+            return;
+        }
+
+        m_is64 = (header[4] == 2);
+        if (m_is64 && !read(0, header, sizeof(header)))
+        {
+            return;
+        }
+
+        // Offsets and sizes of fields differ between ELF32 and ELF64:
+        const size_t word = m_is64 ? 8 : 4;
+        const size_t shift = m_is64 ? 12 : 0;
+
+        m_type = static_cast<unsigned short>(field(header, 16, 2));
+        const unsigned long long phoff = field(header, 28 + (m_is64 ? 4 : 0), word);
+        const unsigned long long shoff = field(header, 32 + (m_is64 ? 8 : 0), word);
+        const auto phentsize = static_cast<size_t>(field(header, 42 + shift, 2));
+        size_t phnum = static_cast<size_t>(field(header, 44 + shift, 2));
+        const auto shentsize = static_cast<size_t>(field(header, 46 + shift, 2));
+        size_t shnum = static_cast<size_t>(field(header, 48 + shift, 2));
+        size_t shstrndx = static_cast<size_t>(field(header, 50 + shift, 2));
+
+        const size_t minPhentsize = m_is64 ? 56 : 32;
+        const size_t minShentsize = m_is64 ? 64 : 40;
+
+        // Counts that don't fit into the header are stored in the first section header (core dumps with many segments):
+        unsigned char entry[64]{};
+        if (shoff && (shentsize >= minShentsize) && read(shoff, entry, minShentsize))
+        {
+            if (!shnum)
+            {
+                shnum = static_cast<size_t>(field(entry, m_is64 ? 32 : 20, word));
+            }
+
+            if (shstrndx == k_extendedCount)
+            {
+                shstrndx = static_cast<size_t>(field(entry, m_is64 ? 40 : 24, 4));
+            }
+
+            if (phnum == k_extendedCount)
+            {
+                phnum = static_cast<size_t>(field(entry, m_is64 ? 44 : 28, 4));
+            }
+        }
+
+        // Tables are read at once as every read of Sig::File maps the file:
+        std::vector<unsigned char> table;
+        if (phoff && phnum && (phentsize >= minPhentsize))
+        {
+            if (!fits(phoff, phnum, phentsize))
+            {
+                return;
+            }
+
+            table.resize(phnum * phentsize);
+            if (!read(phoff, table.data(), table.size()))
+            {
+                return;
+            }
+
+            for (size_t i = 0; i < phnum; ++i)
+            {
+                const auto* const phdr = &table[i * phentsize];
+
+                Segment segment{};
+                segment.type = static_cast<unsigned int>(field(phdr, 0, 4));
+                segment.flags = static_cast<unsigned int>(field(phdr, m_is64 ? 4 : 24, 4));
+                segment.offset = field(phdr, m_is64 ? 8 : 4, word);
+                segment.address = field(phdr, m_is64 ? 16 : 8, word);
+                segment.fileSize = field(phdr, m_is64 ? 32 : 16, word);
+                segment.memorySize = field(phdr, m_is64 ? 40 : 20, word);
+                m_segments.push_back(segment);
+            }
+        }
+
+        if (shoff && shnum && (shentsize >= minShentsize))
+        {
+            if (!fits(shoff, shnum, shentsize))
+            {
+                return;
+            }
+
+            table.resize(shnum * shentsize);
+            if (!read(shoff, table.data(), table.size()))
+            {
+                return;
+            }
+
+            for (size_t i = 0; i < shnum; ++i)
+            {
+                const auto* const shdr = &table[i * shentsize];
+
+                Section section{};
+                section.type = static_cast<unsigned int>(field(shdr, 4, 4));
+                section.flags = field(shdr, 8, word);
+                section.address = field(shdr, m_is64 ? 16 : 12, word);
+                section.offset = field(shdr, m_is64 ? 24 : 16, word);
+                section.size = field(shdr, m_is64 ? 32 : 20, word);
+                m_sections.push_back(section);
+            }
+
+            // Names are offsets in the section of names:
+            std::vector<char> strings;
+            if ((shstrndx < m_sections.size()) && (m_sections[shstrndx].type != k_sectionNoBits))
+            {
+                if (!fits(m_sections[shstrndx].offset, m_sections[shstrndx].size, 1))
+                {
+                    return;
+                }
+
+                strings.resize(static_cast<size_t>(m_sections[shstrndx].size));
+                if (!read(m_sections[shstrndx].offset, strings.data(), strings.size()))
+                {
+                    strings.clear();
+                }
+            }
+
+            for (size_t i = 0; i < m_sections.size(); ++i)
+            {
+                const auto name = static_cast<size_t>(field(&table[i * shentsize], 0, 4));
+                for (size_t pos = name; (pos < strings.size()) && strings[pos]; ++pos)
+                {
+                    m_sections[i].name.push_back(strings[pos]);
+                }
+            }
+        }
+
+        m_valid = true;
+    }
+
+    const unsigned char* m_image = nullptr;
+    const File* m_file = nullptr;
+    unsigned long long m_imageSize = 0;
+    std::vector<Section> m_sections;
+    std::vector<Segment> m_segments;
+    unsigned short m_type = 0;
+    bool m_is64 = false;
+    bool m_valid = false;
+};
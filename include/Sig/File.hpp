@@ -0,0 +1,380 @@
+#pragma once
+
+#include "Sig.hpp"
+
+#include <type_traits>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Scans files without reading them into the memory: the file is mapped read-only by windows
+// that overlap by patternSize - 1 bytes, only one window is mapped at once, so the resident set
+// doesn't depend on the size of the file. Matches are reported by their offsets in the file.
+//
+//   Sig::File file("/usr/lib/libc.so.6");
+//   const unsigned long long offset = file.find("48 8B ? ? 89 05");
+struct Sig::File
+{
+    static constexpr unsigned long long k_notFound = ~0ull;
+    static constexpr size_t k_defaultWindow = 64 * 1024 * 1024;
+    static constexpr size_t k_hugePageSize = 2 * 1024 * 1024;
+
+    struct Options
+    {
+        size_t window = k_defaultWindow; // Rounded up to the mapping granularity
+        bool hugePages = false;          // Aligns windows to huge pages and asks the kernel to back them by huge pages where it's supported
+    };
+
+    explicit File(const char* const path) : File(path, Options{})
+    {
+    }
+
+    File(const char* const path, const Options& options)
+    {
+        m_granularity = options.hugePages ? k_hugePageSize : pageGranularity();
+        const size_t requested = options.window ? options.window : k_defaultWindow;
+        m_window = ((requested + m_granularity - 1) / m_granularity) * m_granularity;
+        m_hugePages = options.hugePages;
+        open(path);
+    }
+
+    File(const File&) = delete;
+    File& operator = (const File&) = delete;
+
+    ~File()
+    {
+        close();
+    }
+
+    bool valid() const
+    {
+        return m_valid;
+    }
+
+    unsigned long long size() const
+    {
+        return m_size;
+    }
+
+    size_t window() const
+    {
+        return m_window;
+    }
+
+    // Any searcher: Sig::Pattern, Sig::FixedPattern<capacity>, Sig::TemplateSearcher<Entries...>, Sig::MaskSearcher<Comparators...>
+    // or a custom type with patternSize() and find(buf, size).
+    // Returns the offset of the first match in the file or Sig::File::k_notFound:
+    template <typename Searcher, typename = std::enable_if_t<std::is_class_v<Searcher>>>
+    unsigned long long find(const Searcher& searcher) const
+    {
+        return find(searcher, 0, m_size);
+    }
+
+    // Pattern format in a template way: file.find<Sig::Byte<0x11, 0x22>, Sig::Dword<>>()
+    template <typename... Entries>
+    unsigned long long find() const
+    {
+        return find(TemplateSearcher<Entries...>{});
+    }
+
+    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF"
+    unsigned long long find(const char* const sig) const
+    {
+        const FixedPattern<k_inlinePatternCapacity> inlined(sig);
+        if (inlined.valid())
+        {
+            return find(inlined);
+        }
+
+        const Pattern pattern(sig);
+        return find(pattern);
+    }
+
+    template <typename... Comparators>
+    unsigned long long find(const char* const sig, const char* const mask) const
+    {
+        return find(MaskSearcher<Comparators...>{ sig, nullptr, mask, mask ? strlen(mask) : 0 });
+    }
+
+    template <typename... Comparators>
+    unsigned long long find(const char* const sig, const char* const subsig, const char* const mask) const
+    {
+        return find(MaskSearcher<Comparators...>{ sig, subsig, mask, mask ? strlen(mask) : 0 });
+    }
+
+    unsigned long long bitmask(const void* const sig, const void* const mask, const size_t sigsize) const
+    {
+        return find(PatternView{ static_cast<const unsigned char*>(sig), static_cast<const unsigned char*>(mask), sigsize });
+    }
+
+    // Calls the visitor for each match: bool visitor(unsigned long long offset) returns false to stop,
+    // void visitor(unsigned long long offset) visits all matches.
+    // Returns the count of visited matches:
+    template <typename Searcher, typename Visitor>
+    size_t findAll(const Searcher& searcher, Visitor&& visitor) const
+    {
+        return findAll(searcher, visitor, 0, m_size);
+    }
+
+    // Scans only the range [from, to) of the file, matches must lie entirely inside it:
+    template <typename Searcher, typename Visitor>
+    size_t findAll(const Searcher& searcher, Visitor&& visitor, const unsigned long long from, const unsigned long long to) const
+    {
+        return scan(searcher, from, to, [&visitor](const unsigned long long offset) -> bool
+        {
+            if constexpr (std::is_void_v<decltype(visitor(offset))>)
+            {
+                visitor(offset);
+                return true;
+            }
+            else
+            {
+                return visitor(offset);
+            }
+        });
+    }
+
+    template <typename Searcher, typename = std::enable_if_t<std::is_class_v<Searcher>>>
+    unsigned long long find(const Searcher& searcher, const unsigned long long from, const unsigned long long to) const
+    {
+        unsigned long long result = k_notFound;
+        scan(searcher, from, to, [&result](const unsigned long long offset) -> bool
+        {
+            result = offset;
+            return false;
+        });
+
+        return result;
+    }
+
+    // Copies bytes of the file, returns false if the range is out of the file:
+    bool read(const unsigned long long offset, void* const buf, const size_t size) const
+    {
+        if (!m_valid || (offset > m_size) || (size > (m_size - offset)))
+        {
+            return false;
+        }
+
+        if (!size)
+        {
+            return true;
+        }
+
+        const unsigned long long start = offset - (offset % m_granularity);
+        const size_t length = static_cast<size_t>(offset - start) + size;
+        const auto* const view = map(start, length);
+        if (!view)
+        {
+            return false;
+        }
+
+        memcpy(buf, view + (offset - start), size);
+        unmap(view, length);
+        return true;
+    }
+
+private:
+    template <typename Searcher, typename Visitor>
+    size_t scan(const Searcher& searcher, const unsigned long long from, unsigned long long to, Visitor&& visitor) const
+    {
+        if (to > m_size)
+        {
+            to = m_size;
+        }
+
+        if (!m_valid || (from >= to))
+        {
+            return 0;
+        }
+
+        const size_t patternSize = searcher.patternSize() ? searcher.patternSize() : 1;
+
+        // Windows start on the mapping granularity, positions before the range are skipped:
+        size_t count = 0;
+        for (unsigned long long start = from - (from % m_granularity); start < to; start += m_window)
+        {
+            const size_t skip = (from > start) ? static_cast<size_t>(from - start) : 0;
+            const unsigned long long rest = to - start;
+            const size_t length = (rest > (m_window + patternSize - 1)) ? (m_window + patternSize - 1) : static_cast<size_t>(rest);
+            if ((length - skip) < patternSize)
+            {
+                break;
+            }
+
+            const auto* const view = map(start, length);
+            if (!view)
+            {
+                break;
+            }
+
+            // Matches that start in the overlap belong to the next window:
+            const size_t positions = ((length - patternSize + 1) < m_window) ? (length - patternSize + 1) : m_window;
+
+            bool proceed = true;
+            for (size_t pos = skip; pos < positions; ++pos)
+            {
+                const void* const found = searcher.find(view + pos, length - pos);
+                if (!found)
+                {
+                    break;
+                }
+
+                pos = static_cast<size_t>(static_cast<const unsigned char*>(found) - view);
+                if (pos >= positions)
+                {
+                    break;
+                }
+
+                ++count;
+                proceed = visitor(start + pos);
+                if (!proceed)
+                {
+                    break;
+                }
+            }
+
+            unmap(view, length);
+
+            if (!proceed)
+            {
+                break;
+            }
+        }
+
+        return count;
+    }
+
+#ifdef _WIN32
+    static size_t pageGranularity()
+    {
+        SYSTEM_INFO info{};
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+    }
+
+    void open(const char* const path)
+    {
+        m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(m_file, &fileSize))
+        {
+            return;
+        }
+
+        m_size = static_cast<unsigned long long>(fileSize.QuadPart);
+        if (m_size)
+        {
+            // Large pages aren't supported for file mappings, so windows are only aligned to them:
+            m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!m_mapping)
+            {
+                return;
+            }
+        }
+
+        m_valid = true;
+    }
+
+    void close()
+    {
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+        }
+
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+        }
+    }
+
+    const unsigned char* map(const unsigned long long offset, const size_t length) const
+    {
+        return static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), length));
+    }
+
+    static void unmap(const unsigned char* const view, const size_t)
+    {
+        UnmapViewOfFile(view);
+    }
+
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    static size_t pageGranularity()
+    {
+        const long pageSize = sysconf(_SC_PAGESIZE);
+        return (pageSize > 0) ? static_cast<size_t>(pageSize) : 4096;
+    }
+
+    void open(const char* const path)
+    {
+        m_fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0)
+        {
+            return;
+        }
+
+        struct stat info{};
+        if (fstat(m_fd, &info) || !S_ISREG(info.st_mode))
+        {
+            return;
+        }
+
+        m_size = static_cast<unsigned long long>(info.st_size);
+        posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        m_valid = true;
+    }
+
+    void close()
+    {
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
+    }
+
+    const unsigned char* map(const unsigned long long offset, const size_t length) const
+    {
+        void* const view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, m_fd, static_cast<off_t>(offset));
+        if (view == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        madvise(view, length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        if (m_hugePages)
+        {
+            madvise(view, length, MADV_HUGEPAGE);
+        }
+#endif
+        return static_cast<const unsigned char*>(view);
+    }
+
+    static void unmap(const unsigned char* const view, const size_t length)
+    {
+        munmap(const_cast<unsigned char*>(view), length);
+    }
+
+    int m_fd = -1;
+#endif
+
+    unsigned long long m_size = 0;
+    size_t m_granularity = 0;
+    size_t m_window = 0;
+    bool m_hugePages = false;
+    bool m_valid = false;
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "Sig.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Splits the buffer into chunks and scans them on a pool of worker threads.
+// Adjacent chunks overlap by patternSize - 1 bytes, so every match lies entirely inside at least one chunk.
+// The result is always the lowest match in the buffer (the same as Sig::find returns): chunks are taken
+// in the ascending order and chunks that start after an already found match are skipped.
+// Scans on the same Sig::Parallel are serialized, use several instances to run them simultaneously.
+struct Sig::Parallel
+{
+    static constexpr size_t k_defaultChunkSize = 1024 * 1024;
+
+    // threads is the total count of scanning threads including the calling one (0 means std::thread::hardware_concurrency()):
+    explicit Parallel(size_t threads = 0, const size_t chunkSize = k_defaultChunkSize) : m_chunkSize(chunkSize ? chunkSize : k_defaultChunkSize)
+    {
+        if (!threads)
+        {
+            threads = std::thread::hardware_concurrency();
+        }
+
+        for (size_t i = 1; i < threads; ++i)
+        {
+            m_workers.emplace_back(&Parallel::work, this);
+        }
+    }
+
+    Parallel(const Parallel&) = delete;
+    Parallel& operator = (const Parallel&) = delete;
+
+    ~Parallel()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(m_lock);
+            m_stop = true;
+        }
+
+        m_wake.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    size_t threads() const
+    {
+        return m_workers.size() + 1;
+    }
+
+    size_t chunkSize() const
+    {
+        return m_chunkSize;
+    }
+
+    // Any searcher: Sig::Pattern, Sig::FixedPattern<capacity>, Sig::TemplateSearcher<Entries...>, Sig::MaskSearcher<Comparators...>
+    // or a custom type with patternSize() and find(buf, size), its find must be safe to call from several threads:
+    template <typename Searcher, typename = std::enable_if_t<std::is_class_v<Searcher>>>
+    const void* find(const void* const buf, const size_t size, const Searcher& searcher)
+    {
+        const size_t overlap = searcher.patternSize() ? (searcher.patternSize() - 1) : 0;
+        if (m_workers.empty() || (size <= m_chunkSize + overlap))
+        {
+            return searcher.find(buf, size);
+        }
+
+        Job job{};
+        job.run = &Parallel::findIn<Searcher>;
+        job.searcher = &searcher;
+        job.buf = static_cast<const unsigned char*>(buf);
+        job.size = size;
+        job.overlap = overlap;
+        job.chunkSize = m_chunkSize;
+        job.next = 0;
+        job.found = size;
+
+        const std::lock_guard<std::mutex> scanLock(m_scanLock);
+
+        {
+            const std::lock_guard<std::mutex> lock(m_lock);
+            m_job = &job;
+            m_busy = m_workers.size();
+            ++m_generation;
+        }
+
+        m_wake.notify_all();
+
+        job.process();
+
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_done.wait(lock, [this]() -> bool
+        {
+            return !m_busy;
+        });
+
+        m_job = nullptr;
+
+        const size_t found = job.found.load(std::memory_order_relaxed);
+        return (found < size) ? (job.buf + found) : nullptr;
+    }
+
+    // Pattern format in a template way: parallel.find<Sig::Byte<0x11, 0x22>, Sig::Dword<>>(buf, size)
+    template <typename... Entries>
+    const void* find(const void* const buf, const size_t size)
+    {
+        return find(buf, size, TemplateSearcher<Entries...>{});
+    }
+
+    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF"
+    const void* find(const void* const buf, const size_t size, const char* const sig)
+    {
+        const FixedPattern<k_inlinePatternCapacity> inlined(sig);
+        if (inlined.valid())
+        {
+            return find(buf, size, inlined);
+        }
+
+        const Pattern pattern(sig);
+        return find(buf, size, pattern);
+    }
+
+    template <typename... Comparators>
+    const void* find(const void* const buf, const size_t size, const char* const sig, const char* const mask, const size_t sigsize)
+    {
+        return find(buf, size, MaskSearcher<Comparators...>{ sig, nullptr, mask, sigsize });
+    }
+
+    template <typename... Comparators>
+    const void* find(const void* const buf, const size_t size, const char* const sig, const char* const mask)
+    {
+        return find<Comparators...>(buf, size, sig, mask, mask ? strlen(mask) : 0);
+    }
+
+    template <typename... Comparators>
+    const void* find(const void* const buf, const size_t size, const char* const sig, const char* const subsig, const char* const mask, const size_t sigsize)
+    {
+        return find(buf, size, MaskSearcher<Comparators...>{ sig, subsig, mask, sigsize });
+    }
+
+    template <typename... Comparators>
+    const void* find(const void* const buf, const size_t size, const char* const sig, const char* const subsig, const char* const mask)
+    {
+        return find<Comparators...>(buf, size, sig, subsig, mask, mask ? strlen(mask) : 0);
+    }
+
+    const void* bitmask(const void* const buf, const size_t size, const void* const sig, const void* const mask, const size_t sigsize)
+    {
+        return find(buf, size, PatternView{ static_cast<const unsigned char*>(sig), static_cast<const unsigned char*>(mask), sigsize });
+    }
+
+private:
+    struct Job
+    {
+        const void* (*run)(const void* searcher, const void* buf, size_t size);
+        const void* searcher;
+        const unsigned char* buf;
+        size_t size;
+        size_t overlap;
+        size_t chunkSize;
+        std::atomic<size_t> next;   // Index of the next chunk to scan
+        std::atomic<size_t> found;  // The lowest offset of a match or size if nothing is found yet
+
+        // Takes chunks until they are exhausted or start after the found match:
+        void process()
+        {
+            for (;;)
+            {
+                const size_t begin = next.fetch_add(1, std::memory_order_relaxed) * chunkSize;
+                if ((begin >= size) || (begin >= found.load(std::memory_order_relaxed)))
+                {
+                    return;
+                }
+
+                const size_t length = ((size - begin) > (chunkSize + overlap)) ? (chunkSize + overlap) : (size - begin);
+
+                const void* const match = run(searcher, buf + begin, length);
+                if (!match)
+                {
+                    continue;
+                }
+
+                const size_t offset = static_cast<size_t>(static_cast<const unsigned char*>(match) - buf);
+                size_t current = found.load(std::memory_order_relaxed);
+                while ((offset < current) && !found.compare_exchange_weak(current, offset, std::memory_order_relaxed))
+                {
+                }
+
+                // All chunks after this one start after the match:
+                return;
+            }
+        }
+    };
+
+    template <typename Searcher>
+    static const void* findIn(const void* const searcher, const void* const buf, const size_t size)
+    {
+        return static_cast<const Searcher*>(searcher)->find(buf, size);
+    }
+
+    void work()
+    {
+        size_t generation = 0;
+        for (;;)
+        {
+            Job* job = nullptr;
+
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_wake.wait(lock, [this, generation]() -> bool
+                {
+                    return m_stop || (m_generation != generation);
+                });
+
+                if (m_stop)
+                {
+                    return;
+                }
+
+                generation = m_generation;
+                job = m_job;
+            }
+
+            job->process();
+
+            {
+                const std::lock_guard<std::mutex> lock(m_lock);
+                --m_busy;
+            }
+
+            m_done.notify_one();
+        }
+    }
+
+    const size_t m_chunkSize;
+    std::vector<std::thread> m_workers;
+    std::mutex m_scanLock;
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    Job* m_job = nullptr;
+    size_t m_busy = 0;
+    size_t m_generation = 0;
+    bool m_stop = false;
+};
@@ -0,0 +1,487 @@
+#pragma once
+
+#include "Sig.hpp"
+
+#include <chrono>
+#include <vector>
+
+
+// Finds all of added patterns in a single pass over the buffer:
+// every pattern is anchored by four or two adjacent exact bytes (or by one exact byte if it has no such run),
+// the anchors are looked up in hash tables for each position of the buffer and only patterns that have
+// the anchor at this position are verified. Scanning is thread-safe, adding patterns is not.
+struct Sig::PatternSet
+{
+    static constexpr size_t k_invalidId = static_cast<size_t>(-1);
+
+    PatternSet() : m_quadHeads(k_buckets, k_none), m_pairHeads(k_buckets, k_none), m_byteHeads(k_bytes, k_none), m_quadBits{}, m_pairBits{}
+    {
+    }
+
+    // Adds the compiled pattern (Sig::Pattern, Sig::FixedPattern<capacity> or Sig::PatternView), the bytes are copied into the set.
+    // Returns the id of the pattern or Sig::PatternSet::k_invalidId if the pattern is empty:
+    size_t add(const PatternView& pattern)
+    {
+        if (!pattern.val || !pattern.msk || !pattern.size)
+        {
+            return k_invalidId;
+        }
+
+        const size_t bytes = reserve(pattern.size);
+        for (size_t i = 0; i < pattern.size; ++i)
+        {
+            m_bytes[bytes + i] = pattern.val[i] & pattern.msk[i];
+            m_bytes[bytes + pattern.size + i] = pattern.msk[i];
+        }
+
+        return commit(bytes, pattern.size);
+    }
+
+    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF"
+    size_t add(const char* const sig)
+    {
+        const size_t sigsize = OneLine::calcSigBytes(sig);
+        if (!sigsize)
+        {
+            return k_invalidId;
+        }
+
+        const size_t bytes = reserve(sigsize);
+        OneLine::parse(sig, &m_bytes[bytes], &m_bytes[bytes + sigsize], sigsize);
+        return commit(bytes, sigsize);
+    }
+
+    // Pattern format: sig ("\x0D\xCB\xFF") + valuable bits in the sig that must match ("\x0D\xFF\x03")
+    size_t addBitmask(const void* const sig, const void* const mask, const size_t sigsize)
+    {
+        return add(PatternView{ static_cast<const unsigned char*>(sig), static_cast<const unsigned char*>(mask), sigsize });
+    }
+
+    // Pattern format: "\x11\x2\x00text" + "..?....", the comparators must be Sig::Mask::Eq and Sig::Mask::Any
+    template <typename... Comparators>
+    size_t add(const char* const sig, const char* const mask)
+    {
+        return add<Comparators...>(sig, nullptr, mask);
+    }
+
+    // Pattern format: "\x11\x2\x00text" + "....\x1C\x03." + "..?.mm.", the comparators must be Sig::Mask::Eq, Sig::Mask::Any and Sig::Mask::BitMask
+    template <typename... Comparators>
+    size_t add(const char* const sig, const char* const subsig, const char* const mask)
+    {
+        const size_t sigsize = mask ? strlen(mask) : 0;
+        if (!sigsize)
+        {
+            return k_invalidId;
+        }
+
+        const size_t bytes = reserve(sigsize);
+        if (!Sig::lowerMask<Comparators...>(sig, subsig, mask, sigsize, &m_bytes[bytes], &m_bytes[bytes + sigsize]))
+        {
+            m_bytes.resize(bytes);
+            return k_invalidId;
+        }
+
+        return commit(bytes, sigsize);
+    }
+
+    size_t count() const
+    {
+        return m_entries.size();
+    }
+
+    PatternView pattern(const size_t id) const
+    {
+        const auto& entry = m_entries[id];
+        return PatternView{ &m_bytes[entry.bytes], &m_bytes[entry.bytes + entry.size], entry.size };
+    }
+
+    // Verifications of a pattern in profiled scans. Reading a clock costs more than a verification, so the cost is counted
+    // in the bytes that the verifications compare rather than in time:
+    struct Cost
+    {
+        unsigned long long candidates;      // Positions that had the anchor of the pattern (or its bucket) and were verified
+        unsigned long long matches;
+        unsigned long long comparedBytes;   // Candidates * size of the pattern
+
+        double falsePositiveRate() const
+        {
+            return candidates ? (static_cast<double>(candidates - matches) / static_cast<double>(candidates)) : 0.0;
+        }
+    };
+
+    // Costs of all patterns by their ids, accumulated over profiled scans:
+    struct Profile
+    {
+        std::vector<Cost> patterns;
+        unsigned long long comparedBytes = 0;   // Bytes compared by the verifications of all patterns
+        unsigned long long nanoseconds = 0;     // Wall time of the scans including the visitor
+
+        // Share of the verification work of the scans spent on the pattern:
+        double share(const size_t id) const
+        {
+            return comparedBytes ? (static_cast<double>(patterns[id].comparedBytes) / static_cast<double>(comparedBytes)) : 0.0;
+        }
+    };
+
+    // Expected selectivity of a pattern on data with the frequencies of bytes of a sample corpus:
+    struct Estimate
+    {
+        double candidatesPerMiB;    // Verifications by the anchor of the pattern, collisions of hashed anchors aren't counted
+        double matchesPerMiB;       // Random matches if bytes were independent, the lower the more selective the pattern
+        Cost sample;                // Measured by a profiled scan of the sample
+    };
+
+    // Calls the visitor for each match of each pattern: bool visitor(size_t id, const void* found) returns false to stop,
+    // void visitor(size_t id, const void* found) visits all matches.
+    // Matches of the same pattern are reported in the ascending order, matches of different patterns are not ordered.
+    // Returns the count of visited matches:
+    template <typename Visitor>
+    size_t scan(const void* const buf, const size_t size, Visitor&& visitor) const
+    {
+        return scan<false>(buf, size, visitor, nullptr);
+    }
+
+    // The same scan that adds the costs of the patterns to the profile, the clock is read only around the whole scan:
+    template <typename Visitor>
+    size_t scan(const void* const buf, const size_t size, Visitor&& visitor, Profile& profile) const
+    {
+        if (profile.patterns.size() < m_entries.size())
+        {
+            profile.patterns.resize(m_entries.size(), Cost{});
+        }
+
+        const auto started = Clock::now();
+        const size_t count = scan<true>(buf, size, visitor, &profile);
+        profile.nanoseconds += elapsed(started);
+        return count;
+    }
+
+    // Scores every pattern against the sample corpus before deployment: the expected counts by the frequencies of bytes
+    // of the sample and the measured ones. Estimates are indexed by the ids of the patterns:
+    std::vector<Estimate> analyze(const void* const sample, const size_t size) const
+    {
+        const auto* const bytes = static_cast<const unsigned char*>(sample);
+
+        double chances[k_bytes]{};
+        for (size_t i = 0; i < size; ++i)
+        {
+            chances[bytes[i]] += 1.0;
+        }
+
+        for (auto& chance : chances)
+        {
+            chance = size ? (chance / static_cast<double>(size)) : 0.0;
+        }
+
+        Profile profile;
+        scan(sample, size, [](size_t, const void*) {}, profile);
+
+        constexpr double k_mib = 1024.0 * 1024.0;
+
+        std::vector<Estimate> estimates(m_entries.size());
+        for (size_t id = 0; id < m_entries.size(); ++id)
+        {
+            const auto& entry = m_entries[id];
+            const auto* const val = &m_bytes[entry.bytes];
+            const auto* const msk = &m_bytes[entry.bytes + entry.size];
+
+            double anchor = 1.0;
+            for (size_t i = 0; i < entry.span; ++i)
+            {
+                anchor *= chances[val[entry.anchor + i]];
+            }
+
+            double match = 1.0;
+            for (size_t i = 0; (i < entry.size) && (match > 0.0); ++i)
+            {
+                double position = 0.0;
+                for (size_t byte = 0; byte < k_bytes; ++byte)
+                {
+                    if ((byte & msk[i]) == val[i])
+                    {
+                        position += chances[byte];
+                    }
+                }
+                match *= position;
+            }
+
+            estimates[id] = Estimate{ anchor * k_mib, match * k_mib, profile.patterns[id] };
+        }
+
+        return estimates;
+    }
+
+    // Finds the first match of every pattern: results[id] receives the match or nullptr, the array must hold count() entries.
+    // Returns the count of found patterns:
+    size_t findFirst(const void* const buf, const size_t size, const void** const results) const
+    {
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            results[i] = nullptr;
+        }
+
+        size_t found = 0;
+        scan(buf, size, [this, results, &found](const size_t id, const void* const match) -> bool
+        {
+            if (!results[id])
+            {
+                results[id] = match;
+                ++found;
+            }
+
+            return found != m_entries.size();
+        });
+
+        return found;
+    }
+
+private:
+    static constexpr size_t k_buckets = 0x10000;
+    static constexpr size_t k_bytes = 0x100;
+    static constexpr unsigned int k_none = static_cast<unsigned int>(-1);
+
+    struct Entry
+    {
+        size_t bytes;       // Offset of the value bytes in m_bytes, the mask bytes follow them
+        size_t size;
+        size_t anchor;      // Offset of the anchor in the pattern
+        size_t span;        // Length of the anchor: 4, 2, 1 or 0 if the pattern has no exact bytes
+        unsigned int next;  // The next entry in the same bucket
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static unsigned long long elapsed(const Clock::time_point since)
+    {
+        return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count());
+    }
+
+    template <bool profiled, typename Visitor>
+    size_t scan(const void* const buf, const size_t size, Visitor& visitor, Profile* const profile) const
+    {
+        const auto* const begin = static_cast<const unsigned char*>(buf);
+        const auto* const end = begin + size;
+
+        size_t count = 0;
+        bool proceed = true;
+
+        const auto visit = [&](const unsigned int index, const unsigned char* const candidate) -> void
+        {
+            ++count;
+            if constexpr (std::is_void_v<decltype(visitor(size_t{}, static_cast<const void*>(candidate)))>)
+            {
+                visitor(static_cast<size_t>(index), static_cast<const void*>(candidate));
+            }
+            else
+            {
+                proceed = visitor(static_cast<size_t>(index), static_cast<const void*>(candidate));
+            }
+        };
+
+        const auto visitBucket = [&](unsigned int index, const unsigned char* const anchor) -> void
+        {
+            while (proceed && (index != k_none))
+            {
+                const auto& entry = m_entries[index];
+                if (static_cast<size_t>(anchor - begin) >= entry.anchor)
+                {
+                    const auto* const candidate = anchor - entry.anchor;
+                    if constexpr (profiled)
+                    {
+                        auto& cost = profile->patterns[index];
+                        ++cost.candidates;
+                        cost.comparedBytes += entry.size;
+                        profile->comparedBytes += entry.size;
+
+                        if ((static_cast<size_t>(end - candidate) >= entry.size)
+                            && Simd::matchesMasked(candidate, &m_bytes[entry.bytes], &m_bytes[entry.bytes + entry.size], entry.size))
+                        {
+                            ++cost.matches;
+                            visit(index, candidate);
+                        }
+                    }
+                    else if ((static_cast<size_t>(end - candidate) >= entry.size)
+                        && Simd::matchesMasked(candidate, &m_bytes[entry.bytes], &m_bytes[entry.bytes + entry.size], entry.size))
+                    {
+                        visit(index, candidate);
+                    }
+                }
+
+                index = entry.next;
+            }
+        };
+
+        // Members are copied to locals as the visitor may alias them for the compiler:
+        const bool hasUnanchored = !m_unanchored.empty();
+        const bool hasBytes = m_hasBytes;
+        const bool hasPairs = m_hasPairs;
+        const auto* const quadBits = m_hasQuads ? m_quadBits : nullptr;
+        const auto* const pairBits = m_pairBits;
+
+        const auto* pos = begin;
+        const auto* const quadEnd = (size >= 4) ? (end - 3) : begin;
+        for (; proceed && (pos < end); ++pos)
+        {
+            if (hasUnanchored)
+            {
+                for (const unsigned int index : m_unanchored)
+                {
+                    visitBucket(index, pos);
+                }
+            }
+
+            if (hasBytes)
+            {
+                visitBucket(m_byteHeads[*pos], pos);
+            }
+
+            if (quadBits && (pos < quadEnd))
+            {
+                const unsigned int key = quadKey(pos);
+                if (quadBits[key / 64] & (1ull << (key % 64)))
+                {
+                    visitBucket(m_quadHeads[key], pos);
+                }
+            }
+
+            if (hasPairs && ((pos + 1) < end))
+            {
+                const unsigned int key = pairKey(pos);
+                if (pairBits[key / 64] & (1ull << (key % 64)))
+                {
+                    visitBucket(m_pairHeads[key], pos);
+                }
+            }
+        }
+
+        return count;
+    }
+
+    size_t reserve(const size_t sigsize)
+    {
+        const size_t bytes = m_bytes.size();
+        m_bytes.resize(bytes + sigsize * 2);
+        return bytes;
+    }
+
+    // Hashes four bytes into the index of a bucket:
+    static unsigned int quadKey(const unsigned char* const pos)
+    {
+        unsigned int quad = 0;
+        memcpy(&quad, pos, sizeof(quad));
+        return (quad * 0x9E3779B1u) >> 16;
+    }
+
+    static unsigned int pairKey(const unsigned char* const pos)
+    {
+        return static_cast<unsigned int>(pos[0]) | (static_cast<unsigned int>(pos[1]) << 8);
+    }
+
+    // Finds the run of exact bytes of the given length with the lowest expected count of candidates:
+    size_t pickRun(const unsigned char* const val, const unsigned char* const msk, const size_t sigsize, const size_t length, const std::vector<unsigned int>& heads, unsigned int (*key)(const unsigned char*)) const
+    {
+        const auto& freq = X64Frequency::k_table;
+
+        unsigned long long bestScore = ~0ull;
+        size_t best = sigsize;
+        for (size_t i = 0; (i + length) <= sigsize; ++i)
+        {
+            unsigned long long score = 1 + bucketSize(heads[key(&val[i])]);
+            for (size_t j = 0; (j < length) && score; ++j)
+            {
+                score = (msk[i + j] == 0xFF) ? (score * freq[val[i + j]]) : 0;
+            }
+
+            if (score && (score < bestScore))
+            {
+                bestScore = score;
+                best = i;
+            }
+        }
+
+        return best;
+    }
+
+    // Chooses the anchor with the lowest expected count of candidates and links the pattern into its bucket:
+    // four exact bytes if the pattern has them, two exact bytes otherwise, then the rarest exact byte:
+    size_t commit(const size_t bytes, const size_t sigsize)
+    {
+        const auto* const val = &m_bytes[bytes];
+        const auto* const msk = &m_bytes[bytes + sigsize];
+
+        const auto id = static_cast<unsigned int>(m_entries.size());
+        m_entries.push_back(Entry{ bytes, sigsize, 0, 0, k_none });
+        auto& entry = m_entries.back();
+
+        const auto link = [id, &entry](std::vector<unsigned int>& heads, const unsigned int key, const size_t anchor, const size_t span)
+        {
+            entry.anchor = anchor;
+            entry.span = span;
+            entry.next = heads[key];
+            heads[key] = id;
+        };
+
+        const size_t quad = pickRun(val, msk, sigsize, 4, m_quadHeads, &quadKey);
+        if (quad < sigsize)
+        {
+            const unsigned int key = quadKey(&val[quad]);
+            link(m_quadHeads, key, quad, 4);
+            m_quadBits[key / 64] |= (1ull << (key % 64));
+            m_hasQuads = true;
+            return id;
+        }
+
+        const size_t pair = pickRun(val, msk, sigsize, 2, m_pairHeads, &pairKey);
+        if (pair < sigsize)
+        {
+            const unsigned int key = pairKey(&val[pair]);
+            link(m_pairHeads, key, pair, 2);
+            m_pairBits[key / 64] |= (1ull << (key % 64));
+            m_hasPairs = true;
+            return id;
+        }
+
+        size_t single = sigsize;
+        for (size_t i = 0; i < sigsize; ++i)
+        {
+            if ((msk[i] == 0xFF) && ((single == sigsize) || (X64Frequency::k_table[val[i]] < X64Frequency::k_table[val[single]])))
+            {
+                single = i;
+            }
+        }
+
+        if (single < sigsize)
+        {
+            link(m_byteHeads, val[single], single, 1);
+            m_hasBytes = true;
+            return id;
+        }
+
+        // No exact bytes at all, the pattern is verified at every position (its next entry is always k_none):
+        m_unanchored.push_back(id);
+        return id;
+    }
+
+    size_t bucketSize(unsigned int index) const
+    {
+        size_t size = 0;
+        while (index != k_none)
+        {
+            ++size;
+            index = m_entries[index].next;
+        }
+        return size;
+    }
+
+    std::vector<unsigned char> m_bytes;
+    std::vector<Entry> m_entries;
+    std::vector<unsigned int> m_quadHeads;
+    std::vector<unsigned int> m_pairHeads;
+    std::vector<unsigned int> m_byteHeads;
+    std::vector<unsigned int> m_unanchored;
+    unsigned long long m_quadBits[k_buckets / 64];
+    unsigned long long m_pairBits[k_buckets / 64];
+    bool m_hasQuads = false;
+    bool m_hasPairs = false;
+    bool m_hasBytes = false;
+};
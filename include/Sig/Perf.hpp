@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Sig.hpp"
+
+#ifdef __linux__
+
+#if !defined(SIG_STATS)
+#   error Sig::Perf fills Sig::Stats, define SIG_STATS before including Sig.hpp
+#endif
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// Adds cycles, cache misses and branch misses of the user mode to Sig::Stats for every scan of the thread
+// that installed it. The counters are opened by perf_event_open for the current thread as one group,
+// they may be unavailable in virtual machines, containers or by /proc/sys/kernel/perf_event_paranoid:
+//
+//   Sig::Perf perf;
+//   if (perf.valid())
+//   {
+//       Sig::Stats::setHook(&perf);
+//   }
+//
+//   Sig::find(buf, size, "48 8B ? ? 89 05");
+//   const unsigned long long cycles = Sig::Stats::last().cycles;
+struct Sig::Perf : Sig::Stats::Hook
+{
+    Perf()
+    {
+        m_cycles = openEvent(PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (m_cycles >= 0)
+        {
+            m_cacheMisses = openEvent(PERF_COUNT_HW_CACHE_MISSES, m_cycles);
+            m_branchMisses = openEvent(PERF_COUNT_HW_BRANCH_MISSES, m_cycles);
+        }
+    }
+
+    Perf(const Perf&) = delete;
+    Perf& operator = (const Perf&) = delete;
+
+    ~Perf() override
+    {
+        const int events[]{ m_branchMisses, m_cacheMisses, m_cycles };
+        for (const int event : events)
+        {
+            if (event >= 0)
+            {
+                close(event);
+            }
+        }
+    }
+
+    bool valid() const
+    {
+        return (m_cycles >= 0) && (m_cacheMisses >= 0) && (m_branchMisses >= 0);
+    }
+
+    void begin() override
+    {
+        if (valid())
+        {
+            ioctl(m_cycles, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(m_cycles, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void end(Stats::Counters& scan) override
+    {
+        if (!valid())
+        {
+            return;
+        }
+
+        ioctl(m_cycles, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // PERF_FORMAT_GROUP: the count of events and their values in the order of opening:
+        unsigned long long values[1 + k_events]{};
+        if ((read(m_cycles, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values))) || (values[0] != k_events))
+        {
+            return;
+        }
+
+        scan.cycles = values[1];
+        scan.cacheMisses = values[2];
+        scan.branchMisses = values[3];
+    }
+
+private:
+    static constexpr unsigned long long k_events = 3;
+
+    // The leader of the group is opened disabled, the others follow it:
+    static int openEvent(const unsigned long long config, const int group)
+    {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = (group < 0) ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+    }
+
+    int m_cycles = -1;
+    int m_cacheMisses = -1;
+    int m_branchMisses = -1;
+};
+
+#endif
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "Sig.hpp"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+// Scans the memory of a live process: readable regions are enumerated from /proc/<pid>/maps
+// and copied by process_vm_readv into a reusable buffer chunk by chunk (chunks overlap by patternSize - 1 bytes).
+// Matches are reported by their addresses in the remote process.
+//
+//   Sig::Process process(pid);
+//   const unsigned long long address = process.find("48 8B ? ? 89 05", Sig::Process::Filter{ Sig::Process::k_exec, "libc.so" });
+struct Sig::Process
+{
+    static constexpr unsigned long long k_notFound = ~0ull;
+    static constexpr size_t k_defaultChunkSize = 4 * 1024 * 1024;
+
+    static constexpr unsigned int k_read = 1;
+    static constexpr unsigned int k_write = 2;
+    static constexpr unsigned int k_exec = 4;
+    static constexpr unsigned int k_shared = 8;
+
+    struct Region
+    {
+        unsigned long long begin;
+        unsigned long long end;
+        unsigned long long offset;  // Offset in the mapped file
+        unsigned int perms;         // Sig::Process::k_read | k_write | k_exec | k_shared
+        std::string path;           // The mapped file, "[heap]", "[stack]" or empty for anonymous memory
+
+        unsigned long long size() const
+        {
+            return end - begin;
+        }
+    };
+
+    // Any callable bool(const Sig::Process::Region&) filters regions as well:
+    struct Filter
+    {
+        unsigned int perms;  // All of these permissions are required, k_read is always required
+        const char* name;    // Substring of the path of the region or nullptr for any region
+
+        bool operator () (const Region& region) const
+        {
+            const unsigned int required = perms | k_read;
+            return ((region.perms & required) == required) && (!name || (region.path.find(name) != std::string::npos));
+        }
+    };
+
+    explicit Process(const pid_t pid, const size_t chunkSize = k_defaultChunkSize) : m_pid(pid), m_chunkSize(chunkSize ? chunkSize : k_defaultChunkSize)
+    {
+        refresh();
+    }
+
+    // False if the regions can't be enumerated or a scan has found that the process can't be read (e.g. it has exited):
+    bool valid() const
+    {
+        return m_valid;
+    }
+
+    pid_t pid() const
+    {
+        return m_pid;
+    }
+
+    const std::vector<Region>& regions() const
+    {
+        return m_regions;
+    }
+
+    // Reenumerates regions of the process, e.g. after it has mapped new modules:
+    bool refresh()
+    {
+        m_regions.clear();
+
+        std::ifstream maps("/proc/" + std::to_string(m_pid) + "/maps");
+        m_valid = maps.is_open();
+
+        std::string line;
+        while (std::getline(maps, line))
+        {
+            // "7f1c2a400000-7f1c2a428000 r--p 00000000 08:01 1234 /usr/lib/x86_64-linux-gnu/libc.so.6"
+            Region region{};
+            char perms[5]{};
+            int pathPos = 0;
+            if (sscanf(line.c_str(), "%llx-%llx %4s %llx %*s %*s %n", &region.begin, &region.end, perms, &region.offset, &pathPos) < 4)
+            {
+                continue;
+            }
+
+            region.perms = ((perms[0] == 'r') ? k_read : 0)
+                | ((perms[1] == 'w') ? k_write : 0)
+                | ((perms[2] == 'x') ? k_exec : 0)
+                | ((perms[3] == 's') ? k_shared : 0);
+
+            if (pathPos > 0)
+            {
+                region.path = line.substr(static_cast<size_t>(pathPos));
+            }
+
+            m_regions.push_back(std::move(region));
+        }
+
+        return m_valid;
+    }
+
+    // Any searcher: Sig::Pattern, Sig::FixedPattern<capacity>, Sig::TemplateSearcher<Entries...>, Sig::MaskSearcher<Comparators...>
+    // or a custom type with patternSize() and find(buf, size).
+    // Returns the remote address of the first match in the filtered regions or Sig::Process::k_notFound:
+    template <typename Searcher, typename Predicate = Filter, typename = std::enable_if_t<std::is_class_v<Searcher>>>
+    unsigned long long find(const Searcher& searcher, const Predicate& filter = Filter{ k_read, nullptr })
+    {
+        unsigned long long result = k_notFound;
+        scan(searcher, filter, [&result](const unsigned long long address) -> bool
+        {
+            result = address;
+            return false;
+        });
+
+        return result;
+    }
+
+    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF"
+    template <typename Predicate = Filter>
+    unsigned long long find(const char* const sig, const Predicate& filter = Filter{ k_read, nullptr })
+    {
+        const FixedPattern<k_inlinePatternCapacity> inlined(sig);
+        if (inlined.valid())
+        {
+            return find(inlined, filter);
+        }
+
+        const Pattern pattern(sig);
+        return find(pattern, filter);
+    }
+
+    // Calls the visitor for each match: bool visitor(unsigned long long address) returns false to stop,
+    // void visitor(unsigned long long address) visits all matches.
+    // Returns the count of visited matches:
+    template <typename Searcher, typename Visitor, typename Predicate = Filter>
+    size_t findAll(const Searcher& searcher, Visitor&& visitor, const Predicate& filter = Filter{ k_read, nullptr })
+    {
+        return scan(searcher, filter, [&visitor](const unsigned long long address) -> bool
+        {
+            if constexpr (std::is_void_v<decltype(visitor(address))>)
+            {
+                visitor(address);
+                return true;
+            }
+            else
+            {
+                return visitor(address);
+            }
+        });
+    }
+
+private:
+    // Copies the remote memory into the buffer, returns the count of copied bytes
+    // (less than size if the range crosses an unreadable page) and errno if nothing was copied:
+    size_t read(const unsigned long long address, const size_t size, int& error)
+    {
+        iovec local{ m_buffer.data(), size };
+        iovec remote{ reinterpret_cast<void*>(static_cast<uintptr_t>(address)), size };
+
+        const ssize_t copied = process_vm_readv(m_pid, &local, 1, &remote, 1, 0);
+        error = (copied < 0) ? errno : 0;
+        return (copied > 0) ? static_cast<size_t>(copied) : 0;
+    }
+
+    template <typename Searcher, typename Predicate, typename Visitor>
+    size_t scan(const Searcher& searcher, const Predicate& filter, Visitor&& visitor)
+    {
+        const size_t patternSize = searcher.patternSize() ? searcher.patternSize() : 1;
+        const auto pageSize = static_cast<unsigned long long>(sysconf(_SC_PAGESIZE));
+
+        m_buffer.resize(m_chunkSize + patternSize - 1);
+
+        size_t count = 0;
+        for (const auto& region : m_regions)
+        {
+            if (!(region.perms & k_read) || !filter(region))
+            {
+                continue;
+            }
+
+            unsigned long long start = region.begin;
+            while (start < region.end)
+            {
+                const unsigned long long rest = region.end - start;
+                const size_t wanted = (rest > m_buffer.size()) ? m_buffer.size() : static_cast<size_t>(rest);
+                int error = 0;
+                const size_t copied = read(start, wanted, error);
+                if (copied < patternSize)
+                {
+                    if (copied == wanted)
+                    {
+                        break; // The rest of the region is smaller than the pattern
+                    }
+
+                    // The process has exited (ESRCH) or can't be read at all (EPERM), so no other page can be read either:
+                    if (error && (error != EFAULT))
+                    {
+                        m_valid = false;
+                        return count;
+                    }
+
+                    // Skips the unreadable page:
+                    start = ((start + copied) / pageSize + 1) * pageSize;
+                    continue;
+                }
+
+                // Matches that start in the overlap are found in the next chunk:
+                const size_t positions = ((copied - patternSize + 1) < m_chunkSize) ? (copied - patternSize + 1) : m_chunkSize;
+                const auto* const buf = m_buffer.data();
+                for (size_t pos = 0; pos < positions; ++pos)
+                {
+                    const void* const found = searcher.find(buf + pos, copied - pos);
+                    if (!found)
+                    {
+                        break;
+                    }
+
+                    pos = static_cast<size_t>(static_cast<const unsigned char*>(found) - buf);
+                    if (pos >= positions)
+                    {
+                        break;
+                    }
+
+                    ++count;
+                    if (!visitor(start + pos))
+                    {
+                        return count;
+                    }
+                }
+
+                if (copied == rest)
+                {
+                    break;
+                }
+
+                start += positions;
+            }
+        }
+
+        return count;
+    }
+
+    pid_t m_pid;
+    size_t m_chunkSize;
+    std::vector<Region> m_regions;
+    std::vector<unsigned char> m_buffer;
+    bool m_valid = false;
+};
+
+#endif
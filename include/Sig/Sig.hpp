@@ -1,6 +1,14 @@
 #pragma once
 
+#include <cstdlib>
 #include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if !defined(_KERNEL_MODE)
+#   include <atomic>
+#endif
 
 
 #if (__cplusplus >= 202002) || _HAS_CXX20
@@ -9,6 +17,83 @@
 #   define sig_has_cxx20  (0)
 #endif
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#   define sig_has_x86  (1)
+#else
+#   define sig_has_x86  (0)
+#endif
+
+// The NEON kernels haven't been run by an ARM64 build of the tests yet, so they are compiled only if SIG_NEON is defined:
+#if (defined(__aarch64__) || defined(_M_ARM64)) && defined(SIG_NEON)
+#   define sig_has_neon  (1)
+#else
+#   define sig_has_neon  (0)
+#endif
+
+// Kernels are compiled for every instruction set that the compiler can target and chosen in runtime by Sig::Simd::dispatch.
+// GCC and Clang take the target of each kernel and inline everything the kernel calls into it, but GCC doesn't inline
+// without optimizations, so its debug builds have only the kernels of the build flags as well as the kernelmode builds
+// that have to save the extended state of the CPU before using it.
+// The set of kernels changes the definitions of Sig::Simd, so translation units of one program that are built with different
+// optimization levels by GCC must agree on it: SIG_NO_DISPATCH leaves only the kernels of the build flags in all of them:
+#if defined(SIG_NO_DISPATCH) || defined(_KERNEL_MODE)
+#   define sig_has_dispatch  (0)
+#elif defined(_MSC_VER) || defined(__clang__) || defined(__OPTIMIZE__)
+#   define sig_has_dispatch  (1)
+#else
+#   define sig_has_dispatch  (0)
+#endif
+
+#if sig_has_x86 && (sig_has_dispatch || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#   define sig_has_sse2  (1)
+#else
+#   define sig_has_sse2  (0)
+#endif
+
+#if sig_has_x86 && (sig_has_dispatch || defined(__AVX2__))
+#   define sig_has_avx2  (1)
+#else
+#   define sig_has_avx2  (0)
+#endif
+
+#if sig_has_x86 && (sig_has_dispatch || defined(__AVX512BW__))
+#   define sig_has_avx512  (1)
+#else
+#   define sig_has_avx512  (0)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#   define sig_target(isa)  __attribute__((target(isa)))
+#   define sig_flatten  __attribute__((flatten))
+#else
+#   define sig_target(isa)
+#   define sig_flatten
+#endif
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+#if sig_has_x86
+#   include <immintrin.h>
+#elif sig_has_neon
+#   include <arm_neon.h>
+#endif
+
+// Counters of Sig::Stats are compiled into the scans only if SIG_STATS is defined before including Sig.hpp:
+#if defined(SIG_STATS)
+#   include <chrono>
+#   define sig_stats(...)  __VA_ARGS__
+#else
+#   define sig_stats(...)
+#endif
+
+// Vector registers are passed between functions of the kernel only after they are inlined:
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 
 struct Sig
 {
@@ -20,12 +105,23 @@ struct Sig
         str,
         raw,
         rep,
+        repRange,
         set,
         range,
         compound
     };
 
 
+    // Reads the value at any address: unaligned loads are valid and compile into a single move:
+    template <typename Type>
+    static Type load(const void* const pos)
+    {
+        Type value;
+        memcpy(&value, pos, sizeof(Type));
+        return value;
+    }
+
+
     struct Cmp
     {
         template <typename Type, Type val>
@@ -33,7 +129,7 @@ struct Sig
         {
             static bool cmp(const void* const pos)
             {
-                return *static_cast<const Type*>(pos) == val;
+                return load<Type>(pos) == val;
             }
         };
 
@@ -42,7 +138,7 @@ struct Sig
         {
             static bool cmp(const void* const pos)
             {
-                return *static_cast<const Type*>(pos) > val;
+                return load<Type>(pos) > val;
             }
         };
 
@@ -51,7 +147,7 @@ struct Sig
         {
             static bool cmp(const void* const pos)
             {
-                return *static_cast<const Type*>(pos) >= val;
+                return load<Type>(pos) >= val;
             }
         };
 
@@ -60,7 +156,7 @@ struct Sig
         {
             static bool cmp(const void* const pos)
             {
-                return *static_cast<const Type*>(pos) < val;
+                return load<Type>(pos) < val;
             }
         };
 
@@ -69,7 +165,7 @@ struct Sig
         {
             static bool cmp(const void* const pos)
             {
-                return *static_cast<const Type*>(pos) <= val;
+                return load<Type>(pos) <= val;
             }
         };
 
@@ -78,7 +174,7 @@ struct Sig
         {
             static bool cmp(const void* const pos)
             {
-                return *static_cast<const Type*>(pos) != val;
+                return load<Type>(pos) != val;
             }
         };
 
@@ -87,7 +183,7 @@ struct Sig
         {
             static bool cmp(const void* const pos)
             {
-                return (*static_cast<const Type*>(pos) & val) != 0;
+                return (load<Type>(pos) & val) != 0;
             }
         };
 
@@ -96,7 +192,7 @@ struct Sig
         {
             static bool cmp(const void* const pos)
             {
-                return (*static_cast<const Type*>(pos) & val) == val;
+                return (load<Type>(pos) & val) == val;
             }
         };
     };
@@ -136,6 +232,7 @@ struct Sig
         using BaseType = Type;
         using Cmp = Comparator<Type, val>;
 
+        static constexpr auto k_value = val;
         static constexpr auto k_tag = Tag::val;
         static constexpr auto k_count = 1;
         static constexpr auto k_size = sizeof(Type);
@@ -161,6 +258,19 @@ struct Sig
         static constexpr auto k_size = k_count * Type::k_size;
     };
 
+    // Greedy repeat of a tag from minCount to maxCount times, the next position is the current one + size of the matched repeats:
+    template <typename Repeatable, size_t minCount, size_t maxCount>
+    struct RepRange
+    {
+        static_assert((minCount != 0) && (minCount <= maxCount), "Sig::RepRange requires 0 < minCount <= maxCount");
+
+        using Type = Repeatable;
+        static constexpr auto k_tag = Tag::repRange;
+        static constexpr auto k_min = minCount;
+        static constexpr auto k_max = maxCount;
+        static constexpr auto k_size = k_max * Type::k_size;
+    };
+
     template <typename... Entries>
     struct Set
     {
@@ -169,7 +279,7 @@ struct Sig
         {
             constexpr decltype(val) k_arr[sizeof...(values) + 1]{ val, values... };
             auto maxval = k_arr[0];
-            for (size_t i = 1; i < sizeof...(values); ++i)
+            for (size_t i = 1; i <= sizeof...(values); ++i)
             {
                 if (k_arr[i] > maxval)
                 {
@@ -259,21 +369,178 @@ struct Sig
         }
     };
 
-    template <typename Rep>
-    struct RepCmp
+    // Counts the leading repeats of the entry: repeats of an exact integral value are compared with a filled block by memcmp,
+    // so long runs (padding, code caves) cost a vectorized compare per block instead of a comparator per repeat:
+    template <typename Repeatable>
+    struct Repeats
     {
-        static bool cmp(const void* const pos)
+        static constexpr bool filled()
         {
-            for (size_t i = 0; i < Rep::k_count; ++i)
+            if constexpr (Repeatable::k_tag == Tag::val)
             {
-                const bool matches = Comparator<typename Rep::Type>::cmp(&static_cast<const typename Rep::Type::BaseType*>(pos)[i]);
-                if (!matches)
+                using Type = typename Repeatable::BaseType;
+                if constexpr (std::is_integral_v<Type> && !std::is_same_v<Type, bool>)
+                {
+                    return std::is_same_v<typename Repeatable::Cmp, Cmp::Eq<Type, Repeatable::k_value>>;
+                }
+                else
                 {
                     return false;
                 }
             }
+            else
+            {
+                return false;
+            }
+        }
 
-            return true;
+        static constexpr bool k_filled = filled();
+        static constexpr size_t k_block = 256;
+
+        // Repeats of a value that has all bytes equal are runs of one byte:
+        static constexpr bool uniform()
+        {
+            if constexpr (k_filled)
+            {
+                const auto value = static_cast<unsigned long long>(Repeatable::k_value);
+                for (size_t i = 1; i < Repeatable::k_size; ++i)
+                {
+                    if (static_cast<unsigned char>(value >> (i * 8)) != static_cast<unsigned char>(value))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        static constexpr bool k_uniform = uniform();
+
+        struct Block
+        {
+            unsigned char bytes[k_block];
+        };
+
+        static constexpr Block fill()
+        {
+            Block block{};
+            if constexpr (k_filled)
+            {
+                for (size_t i = 0; i < k_block; ++i)
+                {
+                    block.bytes[i] = static_cast<unsigned char>(static_cast<unsigned long long>(Repeatable::k_value) >> ((i % Repeatable::k_size) * 8));
+                }
+            }
+            return block;
+        }
+
+        static size_t count(const void* const pos, const size_t limit)
+        {
+            const auto* const bytes = static_cast<const unsigned char*>(pos);
+
+            size_t matched = 0;
+            if constexpr (k_filled)
+            {
+                static constexpr Block k_fill = fill();
+                constexpr size_t k_perBlock = k_block / Repeatable::k_size;
+                while (matched < limit)
+                {
+                    const size_t chunk = ((limit - matched) < k_perBlock) ? (limit - matched) : k_perBlock;
+                    if (memcmp(bytes + matched * Repeatable::k_size, k_fill.bytes, chunk * Repeatable::k_size) != 0)
+                    {
+                        break;
+                    }
+
+                    matched += chunk;
+                }
+            }
+
+            // The mismatched block or the repeats of other entries are compared one by one:
+            while ((matched < limit) && Comparator<Repeatable>::cmp(bytes + matched * Repeatable::k_size))
+            {
+                ++matched;
+            }
+
+            return matched;
+        }
+    };
+
+    // Patterns of one repeat of a byte (padding, code caves) are searched run by run: every start in [pos, pos + length)
+    // covers the last byte of the first window, so the windows are skipped at once if it differs, otherwise the run
+    // that has the byte is measured and skipped as a whole if it is too short:
+    template <typename... Entries>
+    struct ByteRun
+    {
+        static constexpr bool k_exists = false;
+    };
+
+    template <typename Repeatable, size_t count>
+    struct ByteRun<Rep<Repeatable, count>>
+    {
+        static constexpr bool k_exists = Repeats<Repeatable>::k_uniform && (count != 0);
+        static constexpr size_t k_length = count * Repeatable::k_size;
+
+        // All starts in [pos, end) must have k_length bytes to read:
+        static const unsigned char* find(const unsigned char* pos, const unsigned char* const end)
+        {
+            const auto byte = static_cast<unsigned char>(Repeatable::k_value);
+            while (pos < end)
+            {
+                const auto* const probe = pos + k_length - 1;
+                if (*probe != byte)
+                {
+                    pos = probe + 1;
+                    continue;
+                }
+
+                const auto* start = probe;
+                while ((start > pos) && (start[-1] == byte))
+                {
+                    --start;
+                }
+
+                if (start >= end)
+                {
+                    return nullptr;
+                }
+
+                sig_stats(Stats::candidate());
+                sig_stats(Stats::compare());
+
+                const size_t run = Repeats<Repeatable>::count(start, count);
+                if (run == count)
+                {
+                    return start;
+                }
+
+                pos = start + run * Repeatable::k_size + 1;
+            }
+
+            return nullptr;
+        }
+    };
+
+    template <typename Rep>
+    struct RepCmp
+    {
+        static bool cmp(const void* const pos)
+        {
+            return Repeats<typename Rep::Type>::count(pos, Rep::k_count) == Rep::k_count;
+        }
+    };
+
+    // Returns the size of the matched repeats or zero:
+    template <typename Rep>
+    struct RepRangeCmp
+    {
+        static size_t cmp(const void* const pos)
+        {
+            const size_t count = Repeats<typename Rep::Type>::count(pos, Rep::k_max);
+            return (count >= Rep::k_min) ? (count * Rep::Type::k_size) : 0;
         }
     };
 
@@ -298,10 +565,49 @@ struct Sig
 
     struct SetCmp
     {
+        // Sets of many alternatives are skipped at once if no alternative can start with the first byte of the data,
+        // the alternatives that can start with it are compared in their order as before:
+        static constexpr size_t k_minDispatched = 4;
+
+        // starts[byte] is true if any alternative can start with the byte (see Sig::Footprint):
+        template <typename... Entries>
+        struct FirstBytes
+        {
+            bool starts[256]{};
+
+            template <typename Entry>
+            constexpr void allow()
+            {
+                constexpr auto k_layout = Footprint::build<Entry>();
+                for (unsigned int byte = 0; byte < 256; ++byte)
+                {
+                    if ((byte & k_layout.msk[0]) == k_layout.val[0])
+                    {
+                        starts[byte] = true;
+                    }
+                }
+            }
+
+            static constexpr FirstBytes build()
+            {
+                FirstBytes table{};
+                (table.allow<Entries>(), ...);
+                return table;
+            }
+        };
+
         template <template <typename...> typename Set, typename... Entries>
         static size_t cmp(const Set<Entries...>&, const void* const pos)
         {
-            return SetComparator<Entries...>::equals(pos);
+            if constexpr ((sizeof...(Entries) >= k_minDispatched) && ((Entries::k_size != 0) && ...))
+            {
+                static constexpr auto k_firstBytes = FirstBytes<Entries...>::build();
+                return k_firstBytes.starts[*static_cast<const unsigned char*>(pos)] ? SetComparator<Entries...>::equals(pos) : 0;
+            }
+            else
+            {
+                return SetComparator<Entries...>::equals(pos);
+            }
         }
     };
 
@@ -326,12 +632,39 @@ struct Sig
             }
         }
 
+        // Ranges of equalities of integral values are checked by the bounds instead of the comparator per each value:
+        template <typename Range>
+        static constexpr bool bounded()
+        {
+            using Type = typename Range::BaseType;
+            if constexpr (std::is_integral_v<Type> && !std::is_same_v<Type, bool>)
+            {
+                constexpr auto from = static_cast<Type>(Range::k_from);
+                constexpr auto to = static_cast<Type>(Range::k_to);
+                return std::is_same_v<typename Range::template EntryType<from>::Cmp, Cmp::Eq<Type, from>> && (from <= to);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
         template <typename Range>
         static bool cmp(const void* const pos)
         {
-            const auto from = Range::k_from;
-            const auto to = Range::k_to;
-            return equals<Range::template EntryType, Range::k_from, Range::k_to>(pos);
+            if constexpr (bounded<Range>())
+            {
+                // One unsigned compare: values below the lower bound wrap around and exceed the span:
+                using Type = typename Range::BaseType;
+                using Unsigned = std::make_unsigned_t<Type>;
+                constexpr auto from = static_cast<Unsigned>(static_cast<Type>(Range::k_from));
+                constexpr auto span = static_cast<Unsigned>(static_cast<Unsigned>(static_cast<Type>(Range::k_to)) - from);
+                return static_cast<Unsigned>(load<Unsigned>(pos) - from) <= span;
+            }
+            else
+            {
+                return equals<Range::template EntryType, Range::k_from, Range::k_to>(pos);
+            }
         }
     };
 
@@ -369,6 +702,11 @@ struct Sig
                 const size_t size = SetCmp::cmp(Entry{}, pos);
                 return size && Comparator<Entries...>::cmp(static_cast<const unsigned char*>(pos) + size);
             }
+            else if constexpr (Entry::k_tag == Tag::repRange)
+            {
+                const size_t size = RepRangeCmp<Entry>::cmp(pos);
+                return size && Comparator<Entries...>::cmp(static_cast<const unsigned char*>(pos) + size);
+            }
             else if constexpr (Entry::k_tag == Tag::range)
             {
                 const bool matches = RangeCmp::cmp<Entry>(pos);
@@ -416,6 +754,10 @@ struct Sig
             {
                 return SetCmp::cmp(Entry{}, pos) != 0;
             }
+            else if constexpr (Entry::k_tag == Tag::repRange)
+            {
+                return RepRangeCmp<Entry>::cmp(pos) != 0;
+            }
             else if constexpr (Entry::k_tag == Tag::range)
             {
                 return RangeCmp::cmp<Entry>(pos);
@@ -436,674 +778,3647 @@ struct Sig
     };
 
 
-    // Pattern format in a template way:
-    // Sig::find<Sig::Byte<0x11, 0x22>, Sig::Char<'t', 'e', 'x', 't'>, Sig::Dword<>, Sig::Byte<0xFF>>(arr, sizeof(arr));
-    template <typename... Entries>
-    static const void* find(const void* const buf, const size_t size)
+    // Known bytes of the template pattern: the byte at [i] is known when msk[i] != 0:
+    template <size_t capacity>
+    struct Layout
     {
-        constexpr auto k_patternSize = (Entries::k_size + ...);
+        static constexpr auto k_capacity = capacity;
 
-        const auto* pos = static_cast<const unsigned char*>(buf);
-        const auto* const end = static_cast<const unsigned char*>(buf) + size - k_patternSize + 1;
-        while (pos < end)
+        unsigned char val[k_capacity]{};
+        unsigned char msk[k_capacity]{};
+        size_t size = 0; // Count of leading bytes that have fixed offsets (up to the first Sig::Set or Sig::RepRange)
+
+        constexpr void put(const size_t offset, const unsigned char value, const unsigned char mask)
         {
-            const bool equals = Comparator<Entries...>::cmp(pos);
-            if (equals)
+            if (offset < k_capacity)
             {
-                return pos;
+                val[offset] = value & mask;
+                msk[offset] = mask;
             }
-
-            ++pos;
         }
+    };
 
-        return nullptr;
-    }
+    // Builds the layout of the template pattern in compile-time:
+    struct Footprint
+    {
+        static constexpr size_t k_maxSize = 256;
 
+        template <typename Type>
+        static constexpr unsigned char byteOf(const Type value, const size_t index)
+        {
+            return static_cast<unsigned char>(static_cast<unsigned long long>(value) >> (index * 8));
+        }
 
-#if sig_has_cxx20
-    template <String str>
-    struct StrEq : Str<str>
-    {
-        static bool cmp(const void* const pos)
+        template <template <typename...> typename Package, typename... Entries, size_t capacity>
+        static constexpr bool describePackage(const Package<Entries...>&, Layout<capacity>& layout, size_t& offset)
         {
-            const auto* const mem = static_cast<const typename decltype(str)::Type*>(pos);
-            for (size_t i = 0; i < decltype(str)::k_len; ++i)
+            return describeAll<Entries...>(layout, offset);
+        }
+
+        // Returns false if offsets of the next entries are unknown in compile-time:
+        template <typename Entry, size_t capacity>
+        static constexpr bool describe(Layout<capacity>& layout, size_t& offset)
+        {
+            if constexpr (Entry::k_tag == Tag::val)
             {
-                if (mem[i] != str.str.buf[i])
+                using Type = typename Entry::BaseType;
+                if constexpr (std::is_integral_v<Type> && std::is_same_v<typename Entry::Cmp, Cmp::Eq<Type, Entry::k_value>>)
                 {
-                    return false;
+                    for (size_t i = 0; i < sizeof(Type); ++i)
+                    {
+                        layout.put(offset + i, byteOf(Entry::k_value, i), 0xFF);
+                    }
                 }
+                offset += Entry::k_size;
+                return true;
+            }
+            else if constexpr (Entry::k_tag == Tag::pkg)
+            {
+                return describePackage(typename Entry::Package{}, layout, offset);
+            }
+            else if constexpr (Entry::k_tag == Tag::rep)
+            {
+                return describeRepeats<typename Entry::Type>(layout, offset, Entry::k_count);
+            }
+            else if constexpr (Entry::k_tag == Tag::repRange)
+            {
+                // Only the first minimal repeats have known offsets:
+                describeRepeats<typename Entry::Type>(layout, offset, Entry::k_min);
+                return false;
+            }
+            else if constexpr (Entry::k_tag == Tag::compound)
+            {
+                return describePackage(Entry{}, layout, offset);
+            }
+            else if constexpr (Entry::k_tag == Tag::set)
+            {
+                return false;
             }
+            else if constexpr (Entry::k_tag == Tag::range)
+            {
+                // All values of the range share the leading bits of its bounds:
+                if constexpr (RangeCmp::bounded<Entry>())
+                {
+                    using Type = typename Entry::BaseType;
+                    for (size_t i = sizeof(Type); i-- > 0; )
+                    {
+                        const auto low = byteOf(static_cast<Type>(Entry::k_from), i);
+                        const auto high = byteOf(static_cast<Type>(Entry::k_to), i);
 
-            return true;
+                        unsigned char mask = 0xFF;
+                        while ((low & mask) != (high & mask))
+                        {
+                            mask = static_cast<unsigned char>(mask << 1);
+                        }
+
+                        layout.put(offset + i, low, mask);
+                        if (mask != 0xFF)
+                        {
+                            break;
+                        }
+                    }
+                }
+                offset += Entry::k_size;
+                return true;
+            }
+            else
+            {
+                offset += Entry::k_size;
+                return true;
+            }
         }
-    };
 
-    template <String str>
-    struct StrEqNoCase : Str<str>
-    {
-        static bool cmp(const void* const pos)
+        template <typename Entry, size_t capacity>
+        static constexpr bool describeRepeats(Layout<capacity>& layout, size_t& offset, const size_t count)
         {
-            using Char = typename decltype(str)::Type;
-
-            const auto* const mem = static_cast<const Char*>(pos);
-            for (size_t i = 0; i < decltype(str)::k_len; ++i)
+            for (size_t i = 0; i < count; ++i)
             {
-                const auto low = [](const Char ch) -> Char
+                if (offset >= capacity)
                 {
-                    return ((ch >= static_cast<Char>('A')) && (ch <= static_cast<Char>('Z')))
-                        ? (ch + static_cast<Char>('a' - 'A'))
-                        : (ch);
-                };
-
-                const auto left = low(mem[i]);
-                const auto right = low(str.str.buf[i]);
+                    offset += (count - i) * Entry::k_size;
+                    break;
+                }
 
-                if (left != right)
+                if (!describe<Entry>(layout, offset))
                 {
                     return false;
                 }
             }
-
             return true;
         }
-    };
-#endif
 
+        template <typename... Entries, size_t capacity>
+        static constexpr bool describeAll(Layout<capacity>& layout, size_t& offset)
+        {
+            return (describe<Entries>(layout, offset) && ...);
+        }
+
+        template <typename... Entries>
+        static constexpr auto build()
+        {
+            constexpr size_t k_patternSize = (Entries::k_size + ...);
+            constexpr size_t k_capacity = (k_patternSize == 0) ? 1 : ((k_patternSize < k_maxSize) ? k_patternSize : k_maxSize);
+
+            Layout<k_capacity> layout{};
+            size_t offset = 0;
+            describeAll<Entries...>(layout, offset);
+            layout.size = (offset < k_capacity) ? offset : k_capacity;
+            return layout;
+        }
+    };
+
+    // The two rarest exact bytes of the template pattern by the frequency table (see Sig::X64Frequency)
+    // that are checked before the comparators, k_first is the one with the lower offset:
+    template <typename Frequency, typename... Entries>
+    struct Anchors
+    {
+        static constexpr auto k_layout = Footprint::build<Entries...>();
+
+        // Equally frequent bytes are taken as far from the excluded one as possible:
+        static constexpr size_t rarest(const size_t excluded)
+        {
+            const auto distance = [excluded](const size_t offset) -> size_t
+            {
+                return (offset < excluded) ? (excluded - offset) : (offset - excluded);
+            };
+
+            size_t found = k_layout.size;
+            for (size_t i = 0; i < k_layout.size; ++i)
+            {
+                if ((k_layout.msk[i] != 0xFF) || (i == excluded))
+                {
+                    continue;
+                }
+
+                if ((found == k_layout.size)
+                    || (Frequency::k_table[k_layout.val[i]] < Frequency::k_table[k_layout.val[found]])
+                    || ((Frequency::k_table[k_layout.val[i]] == Frequency::k_table[k_layout.val[found]]) && (distance(i) > distance(found))))
+                {
+                    found = i;
+                }
+            }
+            return found;
+        }
+
+        static constexpr size_t k_rarest = rarest(k_layout.size);
+        static constexpr size_t k_second = (rarest(k_rarest) < k_layout.size) ? rarest(k_rarest) : k_rarest;
+
+        static constexpr size_t k_first = (k_rarest < k_second) ? k_rarest : k_second;
+        static constexpr size_t k_last = (k_rarest < k_second) ? k_second : k_rarest;
+        static constexpr bool k_exists = (k_rarest < k_layout.size);
+    };
+
+    // Estimated chances of entries to match a random position of the data that has the frequencies of bytes:
+    template <typename Frequency>
+    struct Selectivity
+    {
+        // Comparators other than equality are assumed to pass a half of positions:
+        static constexpr double k_unknown = 0.5;
+
+        static constexpr double total()
+        {
+            double sum = 0;
+            for (const auto count : Frequency::k_table)
+            {
+                sum += static_cast<double>(count);
+            }
+            return sum;
+        }
+
+        static constexpr double k_total = total();
+
+        template <typename Type>
+        static constexpr double chanceOf(const Type value)
+        {
+            double chance = 1.0;
+            for (size_t i = 0; i < sizeof(Type); ++i)
+            {
+                const auto byte = static_cast<unsigned char>(static_cast<unsigned long long>(value) >> (i * 8));
+                chance *= (k_total > 0) ? (static_cast<double>(Frequency::k_table[byte]) / k_total) : k_unknown;
+            }
+            return chance;
+        }
+
+        // Squarings instead of a multiplication per repeat, so large counts don't exceed the limits of constexpr evaluation:
+        static constexpr double power(double base, size_t exponent)
+        {
+            double result = 1.0;
+            while (exponent)
+            {
+                if (exponent & 1)
+                {
+                    result *= base;
+                }
+                base *= base;
+                exponent >>= 1;
+            }
+            return result;
+        }
+
+        template <template <typename...> typename Package, typename... Entries>
+        static constexpr double packageChance(const Package<Entries...>&)
+        {
+            return (1.0 * ... * chance<Entries>());
+        }
+
+        template <typename Entry>
+        static constexpr double chance()
+        {
+            if constexpr (Entry::k_tag == Tag::val)
+            {
+                using Type = typename Entry::BaseType;
+                if constexpr (std::is_integral_v<Type> && std::is_same_v<typename Entry::Cmp, Cmp::Eq<Type, Entry::k_value>>)
+                {
+                    return chanceOf(Entry::k_value);
+                }
+                else
+                {
+                    return k_unknown;
+                }
+            }
+            else if constexpr (Entry::k_tag == Tag::any)
+            {
+                return 1.0;
+            }
+            else if constexpr (Entry::k_tag == Tag::pkg)
+            {
+                return packageChance(typename Entry::Package{});
+            }
+            else if constexpr (Entry::k_tag == Tag::rep)
+            {
+                return power(chance<typename Entry::Type>(), Entry::k_count);
+            }
+            else if constexpr (Entry::k_tag == Tag::repRange)
+            {
+                return power(chance<typename Entry::Type>(), Entry::k_min);
+            }
+            else if constexpr (Entry::k_tag == Tag::compound)
+            {
+                return packageChance(Entry{});
+            }
+            else if constexpr (Entry::k_tag == Tag::range)
+            {
+                if constexpr (RangeCmp::bounded<Entry>() && (sizeof(typename Entry::BaseType) == 1))
+                {
+                    using Type = typename Entry::BaseType;
+                    double result = 0.0;
+                    for (int value = static_cast<Type>(Entry::k_from); value <= static_cast<Type>(Entry::k_to); ++value)
+                    {
+                        result += chanceOf(static_cast<unsigned char>(value));
+                    }
+                    return result;
+                }
+                else
+                {
+                    return k_unknown;
+                }
+            }
+            else
+            {
+                return k_unknown;
+            }
+        }
+    };
+
+    template <size_t index, typename Entry, typename... Entries>
+    struct At
+    {
+        using Type = typename At<index - 1, Entries...>::Type;
+    };
+
+    template <typename Entry, typename... Entries>
+    struct At<0, Entry, Entries...>
+    {
+        using Type = Entry;
+    };
+
+    // The leading count entries that have fixed offsets (no Sig::Set among them),
+    // they are compared from the least likely to match:
+    template <typename Frequency, size_t count, typename... Entries>
+    struct Run
+    {
+        struct Order
+        {
+            size_t entry[count]{};
+            size_t offset[count]{};
+        };
+
+        static constexpr Order order()
+        {
+            constexpr double k_chances[]{ Selectivity<Frequency>::template chance<Entries>()... };
+            constexpr size_t k_sizes[]{ Entries::k_size... };
+
+            Order result{};
+            size_t offsets[count]{};
+            for (size_t i = 0, offset = 0; i < count; offset += k_sizes[i], ++i)
+            {
+                offsets[i] = offset;
+                result.entry[i] = i;
+            }
+
+            // Stable insertion sort, so equally selective entries keep their order:
+            for (size_t i = 1; i < count; ++i)
+            {
+                for (size_t j = i; (j > 0) && (k_chances[result.entry[j]] < k_chances[result.entry[j - 1]]); --j)
+                {
+                    const size_t entry = result.entry[j];
+                    result.entry[j] = result.entry[j - 1];
+                    result.entry[j - 1] = entry;
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                result.offset[i] = offsets[result.entry[i]];
+            }
+            return result;
+        }
+
+        static constexpr size_t size()
+        {
+            constexpr size_t k_sizes[]{ Entries::k_size... };
+
+            size_t result = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                result += k_sizes[i];
+            }
+            return result;
+        }
+
+        static constexpr Order k_order = order();
+        static constexpr size_t k_size = size();
+
+        template <size_t rank = 0>
+        static bool cmp(const unsigned char* const pos)
+        {
+            if constexpr (rank == count)
+            {
+                return true;
+            }
+            else
+            {
+                using Entry = typename At<k_order.entry[rank], Entries...>::Type;
+                const bool matches = Comparator<Entry>::cmp(pos + k_order.offset[rank]);
+                return matches && cmp<rank + 1>(pos);
+            }
+        }
+    };
+
+    // Compares runs of entries between sets by Sig::Run, sets are kept in place
+    // as offsets of the next entries depend on the size of the matched entry of the set:
+    template <typename Frequency, typename... Entries>
+    struct RankedComparator;
+
+    template <typename Frequency, size_t skip, typename... Entries>
+    struct Rest
+    {
+        using Type = RankedComparator<Frequency, Entries...>;
+    };
+
+    template <typename Frequency, size_t skip, typename Entry, typename... Entries>
+    struct Rest<Frequency, skip, Entry, Entries...>
+    {
+        using Type = typename Rest<Frequency, skip - 1, Entries...>::Type;
+    };
+
+    template <typename Frequency, typename Entry, typename... Entries>
+    struct Rest<Frequency, 0, Entry, Entries...>
+    {
+        using Type = RankedComparator<Frequency, Entry, Entries...>;
+    };
+
+    template <typename Frequency, typename... Entries>
+    struct RankedComparator
+    {
+        static constexpr size_t runLength()
+        {
+            constexpr bool k_sets[]{ ((Entries::k_tag == Tag::set) || (Entries::k_tag == Tag::repRange))..., true };
+
+            size_t length = 0;
+            while (!k_sets[length])
+            {
+                ++length;
+            }
+            return length;
+        }
+
+        static constexpr size_t k_run = runLength();
+
+        static bool cmp(const void* const pos)
+        {
+            const auto* const bytes = static_cast<const unsigned char*>(pos);
+
+            if constexpr (sizeof...(Entries) == 0)
+            {
+                return true;
+            }
+            else if constexpr (k_run == 0)
+            {
+                sig_stats(Stats::compare());
+
+                using Entry = typename At<0, Entries...>::Type;
+                size_t size = 0;
+                if constexpr (Entry::k_tag == Tag::set)
+                {
+                    size = SetCmp::cmp(Entry{}, bytes);
+                }
+                else
+                {
+                    size = RepRangeCmp<Entry>::cmp(bytes);
+                }
+                return size && Rest<Frequency, 1, Entries...>::Type::cmp(bytes + size);
+            }
+            else
+            {
+                sig_stats(Stats::compare());
+
+                using Fixed = Run<Frequency, k_run, Entries...>;
+                const bool matches = Fixed::cmp(bytes);
+                return matches && Rest<Frequency, k_run, Entries...>::Type::cmp(bytes + Fixed::k_size);
+            }
+        }
+    };
+
+    // Exact bytes and wildcards of the template pattern folded into 8-byte (value, mask) words:
+    template <size_t capacity>
+    struct Words
+    {
+        static constexpr auto k_capacity = capacity;
+
+        unsigned long long val[k_capacity]{};
+        unsigned long long msk[k_capacity]{};
+        size_t offset[k_capacity]{};
+        size_t count = 0;
+    };
+
+    // Folds the leading run of exact values and wildcards (Tag::val, Tag::pkg, Tag::any and their reps and compounds)
+    // into a few masked word compares in compile-time:
+    struct Fusion
+    {
+        static constexpr size_t k_maxSize = 64;
+        static constexpr size_t k_wordSize = sizeof(unsigned long long);
+
+        struct Prefix
+        {
+            size_t count; // Count of fused entries
+            size_t size;  // Count of their bytes
+        };
+
+        template <template <typename...> typename Package, typename... Entries>
+        static constexpr bool fusiblePackage(const Package<Entries...>&)
+        {
+            return (fusible<Entries>() && ...);
+        }
+
+        template <typename Entry>
+        static constexpr bool fusible()
+        {
+            if constexpr (Entry::k_tag == Tag::val)
+            {
+                using Type = typename Entry::BaseType;
+                if constexpr (std::is_integral_v<Type>)
+                {
+                    return std::is_same_v<typename Entry::Cmp, Cmp::Eq<Type, Entry::k_value>>;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else if constexpr (Entry::k_tag == Tag::any)
+            {
+                return true;
+            }
+            else if constexpr (Entry::k_tag == Tag::pkg)
+            {
+                return fusiblePackage(typename Entry::Package{});
+            }
+            else if constexpr (Entry::k_tag == Tag::rep)
+            {
+                return fusible<typename Entry::Type>();
+            }
+            else if constexpr (Entry::k_tag == Tag::compound)
+            {
+                return fusiblePackage(Entry{});
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        template <typename... Entries>
+        static constexpr Prefix prefix()
+        {
+            constexpr bool k_fusible[]{ fusible<Entries>()... };
+            constexpr size_t k_sizes[]{ Entries::k_size... };
+
+            Prefix result{ 0, 0 };
+            while ((result.count < sizeof...(Entries)) && k_fusible[result.count] && ((result.size + k_sizes[result.count]) <= k_maxSize))
+            {
+                result.size += k_sizes[result.count];
+                ++result.count;
+            }
+            return result;
+        }
+
+        // Covers [0, span) by words, the last word overlaps the previous one if the span isn't a multiple of the word,
+        // words without known bytes are dropped:
+        template <size_t capacity>
+        static constexpr auto words(const Layout<capacity>& layout, const size_t span)
+        {
+            Words<k_maxSize / k_wordSize> result{};
+            for (size_t start = 0; start < span; start += k_wordSize)
+            {
+                const size_t offset = ((start + k_wordSize) <= span) ? start : ((span >= k_wordSize) ? (span - k_wordSize) : 0);
+
+                unsigned long long val = 0;
+                unsigned long long msk = 0;
+                for (size_t i = 0; (i < k_wordSize) && ((offset + i) < span) && ((offset + i) < layout.size); ++i)
+                {
+                    val |= static_cast<unsigned long long>(layout.val[offset + i]) << (i * 8);
+                    msk |= static_cast<unsigned long long>(layout.msk[offset + i]) << (i * 8);
+                }
+
+                if (msk)
+                {
+                    result.val[result.count] = val;
+                    result.msk[result.count] = msk;
+                    result.offset[result.count] = offset;
+                    ++result.count;
+                }
+            }
+            return result;
+        }
+    };
+
+    // Verifies the fused prefix by branch-free masked loads and the rest entries by Sig::RankedComparator:
+    template <typename Frequency, typename... Entries>
+    struct FusedComparator
+    {
+        static constexpr size_t k_patternSize = (Entries::k_size + ...);
+        static constexpr auto k_prefix = Fusion::prefix<Entries...>();
+
+        // Short prefixes are loaded by a whole word if the pattern is long enough:
+        static constexpr size_t k_span = ((k_prefix.size >= Fusion::k_wordSize) || (k_patternSize < Fusion::k_wordSize))
+            ? k_prefix.size
+            : Fusion::k_wordSize;
+
+        static constexpr auto k_words = Fusion::words(Anchors<Frequency, Entries...>::k_layout, k_span);
+
+        static bool cmp(const void* const pos)
+        {
+            sig_stats(Stats::compare());
+
+            const auto* const bytes = static_cast<const unsigned char*>(pos);
+
+            unsigned long long diff = 0;
+            if constexpr (k_span >= Fusion::k_wordSize)
+            {
+                for (size_t i = 0; i < k_words.count; ++i)
+                {
+                    diff |= (load<unsigned long long>(bytes + k_words.offset[i]) ^ k_words.val[i]) & k_words.msk[i];
+                }
+            }
+            else if constexpr (k_words.count != 0)
+            {
+                unsigned long long word = 0;
+                memcpy(&word, bytes, k_span);
+                diff = (word ^ k_words.val[0]) & k_words.msk[0];
+            }
+
+            return (diff == 0) && Rest<Frequency, k_prefix.count, Entries...>::Type::cmp(bytes + k_prefix.size);
+        }
+    };
+
+    // Boyer-Moore-Horspool search of the longest run of exact bytes of a runtime pattern:
+    // the byte under the end of the window tells how far the run can be shifted, so most bytes of the buffer are skipped:
+    struct Horspool
+    {
+        // Runs are shorter than patterns, so the shifts are limited to keep the table in bytes:
+        static constexpr size_t k_maxLength = 255;
+
+        unsigned char shift[256];
+        const unsigned char* run;
+        size_t length;
+
+        Horspool(const unsigned char* const bytes, const size_t count) : run(bytes), length((count < k_maxLength) ? count : k_maxLength)
+        {
+            for (auto& distance : shift)
+            {
+                distance = static_cast<unsigned char>(length);
+            }
+
+            for (size_t i = 0; (i + 1) < length; ++i)
+            {
+                shift[run[i]] = static_cast<unsigned char>(length - 1 - i);
+            }
+        }
+
+        // Returns the first start of the run in [pos, end), all starts in [pos, end) must have the length bytes to read:
+        const unsigned char* find(const unsigned char* pos, const unsigned char* const end) const
+        {
+            const unsigned char last = run[length - 1];
+            while (pos < end)
+            {
+                const unsigned char tail = pos[length - 1];
+                if ((tail == last) && (memcmp(pos, run, length - 1) == 0))
+                {
+                    return pos;
+                }
+
+                pos += shift[tail];
+            }
+
+            return nullptr;
+        }
+    };
+
+#if defined(SIG_STATS)
+    // Counters of the scans of the current thread, collected only if SIG_STATS is defined before including Sig.hpp.
+    // Every outermost Sig::find, Sig::findRanked, Sig::bitmask and Sig::MaskProgram::find call is a scan:
+    //
+    //   Sig::find(buf, size, "48 8B ? ? 89 05");
+    //   const auto& scan = Sig::Stats::last();
+    //   printf("%llu ns, %f of positions verified\n", scan.nanoseconds, scan.hitRate());
+    struct Stats
+    {
+        struct Counters
+        {
+            unsigned long long scans;           // Outermost calls, the nested ones are counted as a part of them
+            unsigned long long bytes;           // Sizes of the buffers
+            unsigned long long positions;       // Positions that the pattern may start at
+            unsigned long long candidates;      // Positions that passed the prefilter and were verified
+            unsigned long long comparisons;     // Comparator calls of the verifications
+            unsigned long long nanoseconds;     // Wall time
+
+            // Filled by the hook (e.g. Sig::Perf):
+            unsigned long long cycles;
+            unsigned long long cacheMisses;
+            unsigned long long branchMisses;
+
+            // Share of the positions that passed the prefilter:
+            double hitRate() const
+            {
+                return positions ? (static_cast<double>(candidates) / static_cast<double>(positions)) : 0.0;
+            }
+
+            double comparisonsPerCandidate() const
+            {
+                return candidates ? (static_cast<double>(comparisons) / static_cast<double>(candidates)) : 0.0;
+            }
+
+            Counters& operator += (const Counters& counters)
+            {
+                scans += counters.scans;
+                bytes += counters.bytes;
+                positions += counters.positions;
+                candidates += counters.candidates;
+                comparisons += counters.comparisons;
+                nanoseconds += counters.nanoseconds;
+                cycles += counters.cycles;
+                cacheMisses += counters.cacheMisses;
+                branchMisses += counters.branchMisses;
+                return *this;
+            }
+        };
+
+        // Called around every scan of the thread, the time of the hook isn't counted:
+        struct Hook
+        {
+            virtual ~Hook() = default;
+            virtual void begin() = 0;
+            virtual void end(Counters& scan) = 0;
+        };
+
+        // The last scan of the thread:
+        static const Counters& last()
+        {
+            return state().last;
+        }
+
+        // All scans of the thread since the start or the reset:
+        static const Counters& total()
+        {
+            return state().total;
+        }
+
+        static void reset()
+        {
+            state().last = Counters{};
+            state().total = Counters{};
+        }
+
+        // nullptr removes the hook of the thread:
+        static void setHook(Hook* const hook)
+        {
+            state().hook = hook;
+        }
+
+        // Counts the calls of the scan and the calls nested into it as one scan:
+        class Scan
+        {
+        public:
+            Scan(const size_t size, const size_t sigsize) : m_outer(state().depth++ == 0)
+            {
+                if (!m_outer)
+                {
+                    return;
+                }
+
+                auto& current = state();
+                current.last = Counters{};
+                current.last.scans = 1;
+                current.last.bytes = size;
+                current.last.positions = (size >= sigsize) ? (size - sigsize + 1) : 0;
+
+                if (current.hook)
+                {
+                    current.hook->begin();
+                }
+
+                m_begin = Clock::now();
+            }
+
+            Scan(const Scan&) = delete;
+            Scan& operator = (const Scan&) = delete;
+
+            ~Scan()
+            {
+                auto& current = state();
+                --current.depth;
+                if (!m_outer)
+                {
+                    return;
+                }
+
+                const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_begin);
+                current.last.nanoseconds = static_cast<unsigned long long>(elapsed.count());
+
+                if (current.hook)
+                {
+                    current.hook->end(current.last);
+                }
+
+                current.total += current.last;
+            }
+
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            bool m_outer;
+            Clock::time_point m_begin{};
+        };
+
+        static void candidate()
+        {
+            ++state().last.candidates;
+        }
+
+        static void compare()
+        {
+            ++state().last.comparisons;
+        }
+
+    private:
+        struct State
+        {
+            Counters last;
+            Counters total;
+            Hook* hook;
+            size_t depth;
+        };
+
+        static State& state()
+        {
+            static thread_local State s_state{};
+            return s_state;
+        }
+    };
+#endif
+
+    // Instruction sets of the scanning kernels:
+    enum class Isa
+    {
+        scalar,
+        sse2,
+        avx2,
+        avx512,
+        neon
+    };
+
+    struct Simd
+    {
+        static unsigned int lowestSetBit(const unsigned long long mask)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index = 0;
+#if defined(_M_X64) || defined(_M_ARM64)
+            _BitScanForward64(&index, mask);
+#else
+            if (!_BitScanForward(&index, static_cast<unsigned long>(mask)))
+            {
+                _BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+                index += 32;
+            }
+#endif
+            return static_cast<unsigned int>(index);
+#else
+            return static_cast<unsigned int>(__builtin_ctzll(mask));
+#endif
+        }
+
+        struct Scalar
+        {
+            using Reg = unsigned char;
+            using Mask = unsigned int;
+
+            static constexpr size_t k_width = sizeof(Reg);
+
+            static Reg load(const void* const pos)
+            {
+                return *static_cast<const Reg*>(pos);
+            }
+
+            static Reg broadcast(const unsigned char value)
+            {
+                return value;
+            }
+
+            static Mask equals(const Reg left, const Reg right)
+            {
+                return left == right;
+            }
+
+            static Reg zero()
+            {
+                return 0;
+            }
+
+            static Reg bitAnd(const Reg left, const Reg right)
+            {
+                return left & right;
+            }
+
+            static Reg bitOr(const Reg left, const Reg right)
+            {
+                return left | right;
+            }
+
+            static Reg bitXor(const Reg left, const Reg right)
+            {
+                return left ^ right;
+            }
+
+            static bool isZero(const Reg reg)
+            {
+                return reg == 0;
+            }
+
+            // Runs kernel(Vec) compiled for this instruction set:
+            template <typename Kernel>
+            static auto run(const Kernel& kernel)
+            {
+                return kernel(Scalar{});
+            }
+        };
+
+#if sig_has_sse2
+        struct Sse2
+        {
+            using Reg = __m128i;
+            using Mask = unsigned int;
+
+            static constexpr size_t k_width = sizeof(Reg);
+
+            sig_target("sse2") static Reg load(const void* const pos)
+            {
+                return _mm_loadu_si128(static_cast<const Reg*>(pos));
+            }
+
+            sig_target("sse2") static Reg broadcast(const unsigned char value)
+            {
+                return _mm_set1_epi8(static_cast<char>(value));
+            }
+
+            sig_target("sse2") static Mask equals(const Reg left, const Reg right)
+            {
+                return static_cast<Mask>(_mm_movemask_epi8(_mm_cmpeq_epi8(left, right)));
+            }
+
+            sig_target("sse2") static Reg zero()
+            {
+                return _mm_setzero_si128();
+            }
+
+            sig_target("sse2") static Reg bitAnd(const Reg left, const Reg right)
+            {
+                return _mm_and_si128(left, right);
+            }
+
+            sig_target("sse2") static Reg bitOr(const Reg left, const Reg right)
+            {
+                return _mm_or_si128(left, right);
+            }
+
+            sig_target("sse2") static Reg bitXor(const Reg left, const Reg right)
+            {
+                return _mm_xor_si128(left, right);
+            }
+
+            sig_target("sse2") static bool isZero(const Reg reg)
+            {
+                return _mm_movemask_epi8(_mm_cmpeq_epi8(reg, _mm_setzero_si128())) == 0xFFFF;
+            }
+
+            // Runs kernel(Vec) compiled for this instruction set:
+            template <typename Kernel>
+            sig_target("sse2") sig_flatten static auto run(const Kernel& kernel)
+            {
+                return kernel(Sse2{});
+            }
+        };
+#endif
+
+#if sig_has_avx2
+        struct Avx2
+        {
+            using Reg = __m256i;
+            using Mask = unsigned int;
+
+            static constexpr size_t k_width = sizeof(Reg);
+
+            sig_target("avx2") static Reg load(const void* const pos)
+            {
+                return _mm256_loadu_si256(static_cast<const Reg*>(pos));
+            }
+
+            sig_target("avx2") static Reg broadcast(const unsigned char value)
+            {
+                return _mm256_set1_epi8(static_cast<char>(value));
+            }
+
+            sig_target("avx2") static Mask equals(const Reg left, const Reg right)
+            {
+                return static_cast<Mask>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(left, right)));
+            }
+
+            sig_target("avx2") static Reg zero()
+            {
+                return _mm256_setzero_si256();
+            }
+
+            sig_target("avx2") static Reg bitAnd(const Reg left, const Reg right)
+            {
+                return _mm256_and_si256(left, right);
+            }
+
+            sig_target("avx2") static Reg bitOr(const Reg left, const Reg right)
+            {
+                return _mm256_or_si256(left, right);
+            }
+
+            sig_target("avx2") static Reg bitXor(const Reg left, const Reg right)
+            {
+                return _mm256_xor_si256(left, right);
+            }
+
+            sig_target("avx2") static bool isZero(const Reg reg)
+            {
+                return _mm256_testz_si256(reg, reg) != 0;
+            }
+
+            // Runs kernel(Vec) compiled for this instruction set:
+            template <typename Kernel>
+            sig_target("avx2") sig_flatten static auto run(const Kernel& kernel)
+            {
+                return kernel(Avx2{});
+            }
+        };
+#endif
+
+#if sig_has_avx512
+        struct Avx512
+        {
+            using Reg = __m512i;
+            using Mask = unsigned long long;
+
+            static constexpr size_t k_width = sizeof(Reg);
+
+            sig_target("avx512f,avx512bw") static Reg load(const void* const pos)
+            {
+                return _mm512_loadu_si512(pos);
+            }
+
+            sig_target("avx512f,avx512bw") static Reg broadcast(const unsigned char value)
+            {
+                return _mm512_set1_epi8(static_cast<char>(value));
+            }
+
+            sig_target("avx512f,avx512bw") static Mask equals(const Reg left, const Reg right)
+            {
+                return static_cast<Mask>(_mm512_cmpeq_epi8_mask(left, right));
+            }
+
+            sig_target("avx512f,avx512bw") static Reg zero()
+            {
+                return _mm512_setzero_si512();
+            }
+
+            sig_target("avx512f,avx512bw") static Reg bitAnd(const Reg left, const Reg right)
+            {
+                return _mm512_and_si512(left, right);
+            }
+
+            sig_target("avx512f,avx512bw") static Reg bitOr(const Reg left, const Reg right)
+            {
+                return _mm512_or_si512(left, right);
+            }
+
+            sig_target("avx512f,avx512bw") static Reg bitXor(const Reg left, const Reg right)
+            {
+                return _mm512_xor_si512(left, right);
+            }
+
+            sig_target("avx512f,avx512bw") static bool isZero(const Reg reg)
+            {
+                return _mm512_test_epi8_mask(reg, reg) == 0;
+            }
+
+            // Runs kernel(Vec) compiled for this instruction set:
+            template <typename Kernel>
+            sig_target("avx512f,avx512bw") sig_flatten static auto run(const Kernel& kernel)
+            {
+                return kernel(Avx512{});
+            }
+        };
+#endif
+
+#if sig_has_neon
+        struct Neon
+        {
+            using Reg = uint8x16_t;
+            using Mask = unsigned int;
+
+            static constexpr size_t k_width = sizeof(Reg);
+
+            // Weights of bytes to gather the comparison into one bit per byte:
+            static constexpr unsigned char k_bits[k_width]{ 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+
+            static Reg load(const void* const pos)
+            {
+                return vld1q_u8(static_cast<const unsigned char*>(pos));
+            }
+
+            static Reg broadcast(const unsigned char value)
+            {
+                return vdupq_n_u8(value);
+            }
+
+            static Mask equals(const Reg left, const Reg right)
+            {
+                const auto bits = vandq_u8(vceqq_u8(left, right), vld1q_u8(k_bits));
+                return static_cast<Mask>(vaddv_u8(vget_low_u8(bits))) | (static_cast<Mask>(vaddv_u8(vget_high_u8(bits))) << 8);
+            }
+
+            static Reg zero()
+            {
+                return vdupq_n_u8(0);
+            }
+
+            static Reg bitAnd(const Reg left, const Reg right)
+            {
+                return vandq_u8(left, right);
+            }
+
+            static Reg bitOr(const Reg left, const Reg right)
+            {
+                return vorrq_u8(left, right);
+            }
+
+            static Reg bitXor(const Reg left, const Reg right)
+            {
+                return veorq_u8(left, right);
+            }
+
+            static bool isZero(const Reg reg)
+            {
+                return vmaxvq_u8(reg) == 0;
+            }
+
+            // Runs kernel(Vec) compiled for this instruction set:
+            template <typename Kernel>
+            static auto run(const Kernel& kernel)
+            {
+                return kernel(Neon{});
+            }
+        };
+#endif
+
+        static constexpr const char* k_isaNames[]{ "scalar", "sse2", "avx2", "avx512", "neon" };
+
+#if defined(_KERNEL_MODE)
+        // Kernelmode builds have only the kernels of the build flags, so the instruction set is chosen in compile-time
+        // without probing the CPU:
+        static constexpr Isa k_buildIsa = sig_has_neon ? Isa::neon
+            : sig_has_avx512 ? Isa::avx512
+            : sig_has_avx2 ? Isa::avx2
+            : sig_has_sse2 ? Isa::sse2
+            : Isa::scalar;
+
+        static bool supported(const Isa isa)
+        {
+            return isa == k_buildIsa;
+        }
+
+        static Isa current()
+        {
+            return k_buildIsa;
+        }
+#else
+        // The best instruction set that the CPU and the OS support:
+        static Isa probe()
+        {
+#if sig_has_x86 && defined(_MSC_VER) && !defined(__clang__)
+            int regs[4]{};
+            __cpuid(regs, 0);
+            const int leaves = regs[0];
+
+            __cpuid(regs, 1);
+            if (!(regs[3] & (1 << 26)))
+            {
+                return Isa::scalar;
+            }
+
+            if (!(regs[2] & (1 << 27)) || (leaves < 7))
+            {
+                return Isa::sse2;
+            }
+
+            // The OS must save YMM (and ZMM with the opmask) registers on context switches:
+            const auto xcr0 = _xgetbv(0);
+            __cpuidex(regs, 7, 0);
+            if (((xcr0 & 0xE6) == 0xE6) && (regs[1] & (1 << 16)) && (regs[1] & (1 << 30)))
+            {
+                return Isa::avx512;
+            }
+
+            if (((xcr0 & 0x06) == 0x06) && (regs[1] & (1 << 5)))
+            {
+                return Isa::avx2;
+            }
+
+            return Isa::sse2;
+#elif sig_has_x86
+            // Checks the support of the OS as well:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+            {
+                return Isa::avx512;
+            }
+
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return Isa::avx2;
+            }
+
+            return __builtin_cpu_supports("sse2") ? Isa::sse2 : Isa::scalar;
+#elif sig_has_neon
+            return Isa::neon;
+#else
+            return Isa::scalar;
+#endif
+        }
+
+        // The kernels of the instruction set are compiled and the CPU supports it:
+        static bool supported(const Isa isa)
+        {
+            static const Isa cpu = probe();
+            switch (isa)
+            {
+            case Isa::sse2:
+                return sig_has_sse2 && (cpu >= Isa::sse2);
+            case Isa::avx2:
+                return sig_has_avx2 && (cpu >= Isa::avx2);
+            case Isa::avx512:
+                return sig_has_avx512 && (cpu >= Isa::avx512);
+            case Isa::neon:
+                return sig_has_neon && (cpu == Isa::neon);
+            default:
+                return true;
+            }
+        }
+
+        static Isa best()
+        {
+            const Isa order[]{ Isa::neon, Isa::avx512, Isa::avx2, Isa::sse2 };
+            for (const auto isa : order)
+            {
+                if (supported(isa))
+                {
+                    return isa;
+                }
+            }
+
+            return Isa::scalar;
+        }
+
+        // The SIG_ISA environment variable if it names a supported instruction set or the best one:
+        static Isa initial()
+        {
+            char name[16]{};
+#if defined(_MSC_VER)
+            size_t length = 0;
+            if (getenv_s(&length, name, sizeof(name), "SIG_ISA") != 0)
+            {
+                name[0] = '\0';
+            }
+#else
+            const char* const variable = getenv("SIG_ISA");
+            if (variable && (strlen(variable) < sizeof(name)))
+            {
+                strcpy(name, variable);
+            }
+#endif
+            for (size_t i = 0; i < (sizeof(k_isaNames) / sizeof(*k_isaNames)); ++i)
+            {
+                if ((strcmp(name, k_isaNames[i]) == 0) && supported(static_cast<Isa>(i)))
+                {
+                    return static_cast<Isa>(i);
+                }
+            }
+
+            return best();
+        }
+
+        // Read by the scans of all threads while Sig::setIsa() may change it:
+        static std::atomic<Isa>& selected()
+        {
+            static std::atomic<Isa> isa{ initial() };
+            return isa;
+        }
+
+        static Isa current()
+        {
+            return selected().load(std::memory_order_relaxed);
+        }
+#endif
+
+        // Runs kernel(Vec) with the Vec of the selected instruction set, the kernel is instantiated for all of them:
+        template <typename Kernel>
+        static auto dispatch(const Kernel& kernel)
+        {
+            switch (current())
+            {
+#if sig_has_avx512
+            case Isa::avx512:
+                return Avx512::run(kernel);
+#endif
+#if sig_has_avx2
+            case Isa::avx2:
+                return Avx2::run(kernel);
+#endif
+#if sig_has_sse2
+            case Isa::sse2:
+                return Sse2::run(kernel);
+#endif
+#if sig_has_neon
+            case Isa::neon:
+                return Neon::run(kernel);
+#endif
+            default:
+                return Scalar::run(kernel);
+            }
+        }
+
+        // Checks the two anchor bytes in Vec::k_width positions at once and verifies only the positions where both of them match.
+        // All positions in [pos, end) must be valid to read at the anchor offsets:
+        template <typename Vec, typename Verifier>
+        static const unsigned char* findPair(
+            const unsigned char* pos,
+            const unsigned char* const end,
+            const size_t firstOffset,
+            const unsigned char first,
+            const size_t lastOffset,
+            const unsigned char last,
+            const Verifier& verify
+        )
+        {
+            const auto firstVec = Vec::broadcast(first);
+            const auto lastVec = Vec::broadcast(last);
+
+            while (static_cast<size_t>(end - pos) >= Vec::k_width)
+            {
+                auto mask = Vec::equals(Vec::load(pos + firstOffset), firstVec) & Vec::equals(Vec::load(pos + lastOffset), lastVec);
+                while (mask)
+                {
+                    const auto* const candidate = pos + lowestSetBit(mask);
+                    if (verify(candidate))
+                    {
+                        return candidate;
+                    }
+
+                    mask &= mask - 1;
+                }
+
+                pos += Vec::k_width;
+            }
+
+            while (pos < end)
+            {
+                if ((pos[firstOffset] == first) && (pos[lastOffset] == last) && verify(pos))
+                {
+                    return pos;
+                }
+
+                ++pos;
+            }
+
+            return nullptr;
+        }
+
+        // The largest pattern that is kept in registers by Sig::Simd::findMasked:
+        static constexpr size_t k_maxMaskedSize = 64;
+
+        static bool matchesMasked(const unsigned char* const pos, const unsigned char* const val, const unsigned char* const msk, const size_t size)
+        {
+            // Long patterns are compared by masked words, wildcards are zeroed by the mask:
+            size_t i = 0;
+            for (; (i + sizeof(unsigned long long)) <= size; i += sizeof(unsigned long long))
+            {
+                const auto mask = load<unsigned long long>(&msk[i]);
+                if (((load<unsigned long long>(&pos[i]) ^ load<unsigned long long>(&val[i])) & mask) != 0)
+                {
+                    return false;
+                }
+            }
+
+            for (; i < size; ++i)
+            {
+                if ((pos[i] & msk[i]) != (val[i] & msk[i]))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Value/mask pattern loaded into registers once, every candidate is checked by one masked compare per register:
+        template <typename Vec, size_t regs>
+        struct MaskedPattern
+        {
+            static constexpr size_t k_size = regs * Vec::k_width;
+
+            typename Vec::Reg val[regs];
+            typename Vec::Reg msk[regs];
+
+            MaskedPattern(const unsigned char* const value, const unsigned char* const mask, const size_t size)
+            {
+                unsigned char valBytes[k_size]{};
+                unsigned char mskBytes[k_size]{};
+                for (size_t i = 0; (i < size) && (i < k_size); ++i)
+                {
+                    mskBytes[i] = mask[i];
+                    valBytes[i] = value[i] & mask[i];
+                }
+
+                for (size_t i = 0; i < regs; ++i)
+                {
+                    val[i] = Vec::load(&valBytes[i * Vec::k_width]);
+                    msk[i] = Vec::load(&mskBytes[i * Vec::k_width]);
+                }
+            }
+
+            // Reads k_size bytes from the pos:
+            bool matches(const unsigned char* const pos) const
+            {
+                auto diff = Vec::zero();
+                for (size_t i = 0; i < regs; ++i)
+                {
+                    diff = Vec::bitOr(diff, Vec::bitAnd(Vec::bitXor(Vec::load(pos + i * Vec::k_width), val[i]), msk[i]));
+                }
+
+                return Vec::isZero(diff);
+            }
+        };
+
+        // Chooses two bytes to prefilter candidates by: the first and the last fully masked bytes or, if there are no such bytes, the first and the last meaningful ones.
+        // Returns false if the pattern has no meaningful bits at all:
+        static bool pickMaskedAnchors(const unsigned char* const msk, const size_t size, size_t& first, size_t& last)
+        {
+            const auto pick = [msk, size, &first, &last](const bool exactOnly) -> bool
+            {
+                bool found = false;
+                for (size_t i = 0; i < size; ++i)
+                {
+                    if (exactOnly ? (msk[i] == 0xFF) : (msk[i] != 0x00))
+                    {
+                        if (!found)
+                        {
+                            first = i;
+                            found = true;
+                        }
+                        last = i;
+                    }
+                }
+                return found;
+            };
+
+            return pick(true) || pick(false);
+        }
+
+        // The longest run of exact bytes of the pattern, returns its length:
+        static size_t longestRun(const unsigned char* const msk, const size_t size, size_t& offset)
+        {
+            size_t longest = 0;
+            for (size_t i = 0; i < size; )
+            {
+                size_t length = 0;
+                while (((i + length) < size) && (msk[i + length] == 0xFF))
+                {
+                    ++length;
+                }
+
+                if (length > longest)
+                {
+                    longest = length;
+                    offset = i;
+                }
+
+                i += length + 1;
+            }
+
+            return longest;
+        }
+
+        // Runs that are long enough to be searched by Sig::Horspool in builds without SIMD:
+        // vector anchors check 16 or 32 candidates per iteration and outrun the skips of any run.
+        static constexpr size_t k_minRunLength = 6;
+
+        // Scans Vec::k_width candidates per iteration for two masked anchor bytes and verifies the hits:
+        // in registers if the pattern fits regs * Vec::k_width bytes and the buffer has enough bytes after the candidate, or byte by byte otherwise:
+        template <typename Vec, size_t regs>
+        static const unsigned char* findMasked(
+            const unsigned char* const buf,
+            const size_t size,
+            const unsigned char* const val,
+            const unsigned char* const msk,
+            const size_t sigsize
+        )
+        {
+            size_t firstOffset = 0;
+            size_t lastOffset = 0;
+            if (!pickMaskedAnchors(msk, sigsize, firstOffset, lastOffset))
+            {
+                return buf;
+            }
+
+            const auto firstMsk = Vec::broadcast(msk[firstOffset]);
+            const auto firstVal = Vec::broadcast(val[firstOffset] & msk[firstOffset]);
+            const auto lastMsk = Vec::broadcast(msk[lastOffset]);
+            const auto lastVal = Vec::broadcast(val[lastOffset] & msk[lastOffset]);
+
+            const MaskedPattern<Vec, (regs ? regs : 1)> pattern(val, msk, sigsize);
+
+            const auto verify = [&](const unsigned char* const candidate) -> bool
+            {
+                sig_stats(Stats::candidate());
+                sig_stats(Stats::compare());
+
+                if constexpr (regs != 0)
+                {
+                    if (static_cast<size_t>((buf + size) - candidate) >= pattern.k_size)
+                    {
+                        return pattern.matches(candidate);
+                    }
+                }
+
+                return matchesMasked(candidate, val, msk, sigsize);
+            };
+
+            const auto* pos = buf;
+            const auto* const end = buf + size - sigsize + 1;
+
+            // Long fixed runs skip the most of the buffer, the rest bytes are verified around each occurrence of the run:
+            if constexpr (std::is_same_v<Vec, Scalar>)
+            {
+                size_t runOffset = 0;
+                const size_t runLength = longestRun(msk, sigsize, runOffset);
+                if (runLength >= k_minRunLength)
+                {
+                    const Horspool run(&val[runOffset], runLength);
+                    for (const auto* found = run.find(pos + runOffset, end + runOffset); found; found = run.find(found + 1, end + runOffset))
+                    {
+                        const auto* const candidate = found - runOffset;
+                        if (verify(candidate))
+                        {
+                            return candidate;
+                        }
+                    }
+
+                    return nullptr;
+                }
+            }
+
+            while (static_cast<size_t>(end - pos) >= Vec::k_width)
+            {
+                auto mask = Vec::equals(Vec::bitAnd(Vec::load(pos + firstOffset), firstMsk), firstVal)
+                          & Vec::equals(Vec::bitAnd(Vec::load(pos + lastOffset), lastMsk), lastVal);
+                while (mask)
+                {
+                    const auto* const candidate = pos + lowestSetBit(mask);
+                    if (verify(candidate))
+                    {
+                        return candidate;
+                    }
+
+                    mask &= mask - 1;
+                }
+
+                pos += Vec::k_width;
+            }
+
+            while (pos < end)
+            {
+                sig_stats(Stats::candidate());
+                sig_stats(Stats::compare());
+
+                if (matchesMasked(pos, val, msk, sigsize))
+                {
+                    return pos;
+                }
+
+                ++pos;
+            }
+
+            return nullptr;
+        }
+
+        // Selects the count of registers to keep the pattern in:
+        template <typename Vec>
+        static const unsigned char* findMasked(
+            const unsigned char* const buf,
+            const size_t size,
+            const unsigned char* const val,
+            const unsigned char* const msk,
+            const size_t sigsize
+        )
+        {
+            if (sigsize <= Vec::k_width)
+            {
+                return findMasked<Vec, 1>(buf, size, val, msk, sigsize);
+            }
+            else if ((sigsize <= 2 * Vec::k_width) && (sigsize <= k_maxMaskedSize))
+            {
+                return findMasked<Vec, 2>(buf, size, val, msk, sigsize);
+            }
+            else if ((sigsize <= 4 * Vec::k_width) && (sigsize <= k_maxMaskedSize))
+            {
+                return findMasked<Vec, 4>(buf, size, val, msk, sigsize);
+            }
+            else
+            {
+                return findMasked<Vec, 0>(buf, size, val, msk, sigsize);
+            }
+        }
+    };
+
+    // Instruction set of the scanning kernels: the best one that the CPU supports unless the SIG_ISA environment variable
+    // (scalar, sse2, avx2, avx512 or neon) or Sig::setIsa() chose another one, e.g. to test and benchmark every kernel on one machine:
+    static Isa isa()
+    {
+        return Simd::current();
+    }
+
+    // Keeps the current instruction set and returns false if the CPU or the build doesn't support the given one.
+    // Scans that are running in other threads finish with the kernels they started with.
+    // Kernelmode builds have only one instruction set:
+    static bool setIsa(const Isa isa)
+    {
+        if (!Simd::supported(isa))
+        {
+            return false;
+        }
+
+#if !defined(_KERNEL_MODE)
+        Simd::selected().store(isa, std::memory_order_relaxed);
+#endif
+        return true;
+    }
+
+
+    // Bit-parallel Shift-Or matcher for runtime patterns up to 64 * words bytes: each position of the pattern is a class of bytes
+    // (Eq, Any, BitMask or any other byte comparator), so every byte of the buffer costs one lookup and one shift
+    // regardless of wildcards. The bit i of the state is zero when the pattern[0..i] matches the bytes that end at the current one.
+    // The table is kept inline (up to 8 KB on the stack), the static functions work with tables that are built once by Sig::Bitap::Table:
+    template <size_t words>
+    struct ShiftOr
+    {
+        static constexpr size_t k_capacity = words * 64;
+        static constexpr size_t k_tableSize = 256 * words;
+
+        explicit ShiftOr(const size_t size) : m_size(size)
+        {
+            reset(m_table);
+        }
+
+        ShiftOr(const ShiftOr&) = delete;
+        ShiftOr& operator = (const ShiftOr&) = delete;
+
+        // Adds the byte to the class of the position:
+        void allow(const size_t position, const unsigned char byte)
+        {
+            allow(m_table, position, byte);
+        }
+
+        const unsigned char* find(const unsigned char* const buf, const size_t size) const
+        {
+            return find(m_table, m_size, buf, size);
+        }
+
+        static void reset(unsigned long long* const table)
+        {
+            for (size_t i = 0; i < k_tableSize; ++i)
+            {
+                table[i] = ~0ull;
+            }
+        }
+
+        static void allow(unsigned long long* const table, const size_t position, const unsigned char byte)
+        {
+            table[byte * words + position / 64] &= ~(1ull << (position % 64));
+        }
+
+        static const unsigned char* find(const unsigned long long* const table, const size_t sigsize, const unsigned char* const buf, const size_t size)
+        {
+            const size_t lastWord = (sigsize - 1) / 64;
+            const unsigned long long lastBit = 1ull << ((sigsize - 1) % 64);
+
+            unsigned long long state[words];
+            for (size_t w = 0; w < words; ++w)
+            {
+                state[w] = ~0ull;
+            }
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                const auto* const row = &table[buf[i] * words];
+                for (size_t w = words - 1; w > 0; --w)
+                {
+                    state[w] = ((state[w] << 1) | (state[w - 1] >> 63)) | row[w];
+                }
+                state[0] = (state[0] << 1) | row[0];
+
+                if (!(state[lastWord] & lastBit))
+                {
+                    return buf + i + 1 - sigsize;
+                }
+            }
+
+            return nullptr;
+        }
+
+    private:
+        unsigned long long m_table[k_tableSize];
+        size_t m_size;
+    };
+
+    // Chooses between the anchored search and Sig::ShiftOr for runtime patterns:
+    struct Bitap
+    {
+        // Kernel stacks can't hold the table and there is no heap to build it once, so kernelmode builds use only anchors:
+#if defined(_KERNEL_MODE)
+        static constexpr bool k_enabled = false;
+#else
+        static constexpr bool k_enabled = true;
+#endif
+
+        static constexpr size_t k_maxSize = ShiftOr<4>::k_capacity;
+
+        // Building the table costs 256 checks per byte of the pattern, so short buffers are scanned by anchors:
+        static constexpr size_t k_minBufferPerByte = 64;
+
+        static size_t bitsOf(unsigned char byte)
+        {
+            size_t bits = 0;
+            for (; byte; byte &= static_cast<unsigned char>(byte - 1))
+            {
+                ++bits;
+            }
+            return bits;
+        }
+
+        static bool fits(const size_t sigsize, const size_t size)
+        {
+            return k_enabled && sigsize && (sigsize <= k_maxSize) && ((size / sigsize) >= k_minBufferPerByte);
+        }
+
+        // Value/mask patterns: SIMD anchors with the verification in registers outrun the table even for weak anchors,
+        // but the scalar anchor loop doesn't, so the table is used without SIMD for patterns that fit one word
+        // and for longer ones whose anchors have less meaningful bits than an exact byte:
+        static bool preferred(const unsigned char* const msk, const size_t sigsize, const size_t size)
+        {
+            return (isa() == Isa::scalar) && fits(sigsize, size) && suits(msk, sigsize);
+        }
+
+        // The part of Sig::Bitap::preferred that depends only on the pattern:
+        static bool suits(const unsigned char* const msk, const size_t sigsize)
+        {
+            if (!k_enabled || !sigsize || (sigsize > k_maxSize))
+            {
+                return false;
+            }
+
+            // Long fixed runs are skipped through by Sig::Horspool:
+            size_t runOffset = 0;
+            if (Simd::longestRun(msk, sigsize, runOffset) >= Simd::k_minRunLength)
+            {
+                return false;
+            }
+
+            if (sigsize <= ShiftOr<1>::k_capacity)
+            {
+                return true;
+            }
+
+            size_t first = 0;
+            size_t last = 0;
+            if (!Simd::pickMaskedAnchors(msk, sigsize, first, last))
+            {
+                return false;
+            }
+
+            const size_t bits = bitsOf(msk[first]) + ((first != last) ? bitsOf(msk[last]) : 0);
+            return bits < 8;
+        }
+
+        // Allows the bytes that match the value/mask pattern:
+        template <typename Table>
+        static void allowMasked(Table& table, const unsigned char* const val, const unsigned char* const msk, const size_t sigsize)
+        {
+            for (size_t i = 0; i < sigsize; ++i)
+            {
+                for (unsigned int byte = 0; byte < 256; ++byte)
+                {
+                    if ((byte & msk[i]) == (val[i] & msk[i]))
+                    {
+                        table.allow(i, static_cast<unsigned char>(byte));
+                    }
+                }
+            }
+        }
+
+        // Fills the table on the stack by build(table) and searches by it:
+#if defined(_KERNEL_MODE)
+        template <typename Builder, typename Fallback>
+        static const void* find(const unsigned char*, size_t, size_t, const Builder&, const Fallback& fallback)
+        {
+            return fallback();
+        }
+#else
+        template <size_t words, typename Builder>
+        static const void* find(const unsigned char* const buf, const size_t size, const size_t sigsize, const Builder& build)
+        {
+            ShiftOr<words> table(sigsize);
+            build(table);
+            return table.find(buf, size);
+        }
+
+        template <typename Builder, typename Fallback>
+        static const void* find(const unsigned char* const buf, const size_t size, const size_t sigsize, const Builder& build, const Fallback&)
+        {
+            if (sigsize <= ShiftOr<1>::k_capacity)
+            {
+                return find<1>(buf, size, sigsize, build);
+            }
+            else if (sigsize <= ShiftOr<2>::k_capacity)
+            {
+                return find<2>(buf, size, sigsize, build);
+            }
+            else
+            {
+                return find<4>(buf, size, sigsize, build);
+            }
+        }
+#endif
+
+        // Table built once by compiled patterns (Sig::Pattern, Sig::MaskProgram), so their scans don't rebuild it.
+        // It stays empty in kernelmode builds and if the allocation fails:
+        struct Table
+        {
+            Table() = default;
+
+            Table(const Table&) = delete;
+            Table& operator = (const Table&) = delete;
+
+#if !defined(_KERNEL_MODE)
+            Table(Table&& table) noexcept : m_data(table.m_data), m_size(table.m_size), m_words(table.m_words)
+            {
+                table.m_data = nullptr;
+                table.m_size = 0;
+                table.m_words = 0;
+            }
+
+            Table& operator = (Table&& table) noexcept
+            {
+                if (&table == this)
+                {
+                    return *this;
+                }
+
+                delete[] m_data;
+
+                m_data = table.m_data;
+                m_size = table.m_size;
+                m_words = table.m_words;
+
+                table.m_data = nullptr;
+                table.m_size = 0;
+                table.m_words = 0;
+
+                return *this;
+            }
+
+            ~Table()
+            {
+                delete[] m_data;
+            }
+#endif
+
+#if defined(_KERNEL_MODE)
+            template <typename Builder>
+            void build(size_t, const Builder&)
+            {
+            }
+#else
+            template <typename Builder>
+            void build(const size_t sigsize, const Builder& builder)
+            {
+                if (!sigsize || (sigsize > k_maxSize) || m_data)
+                {
+                    return;
+                }
+
+                const size_t words = (sigsize <= ShiftOr<1>::k_capacity) ? 1 : (sigsize <= ShiftOr<2>::k_capacity) ? 2 : 4;
+                m_data = new (std::nothrow) unsigned long long[256 * words];
+                if (!m_data)
+                {
+                    return;
+                }
+
+                for (size_t i = 0; i < 256 * words; ++i)
+                {
+                    m_data[i] = ~0ull;
+                }
+
+                m_size = sigsize;
+                m_words = words;
+                builder(*this);
+            }
+#endif
+
+            bool valid() const
+            {
+                return m_data != nullptr;
+            }
+
+            void allow(const size_t position, const unsigned char byte)
+            {
+                m_data[byte * m_words + position / 64] &= ~(1ull << (position % 64));
+            }
+
+            const void* find(const unsigned char* const buf, const size_t size) const
+            {
+                switch (m_words)
+                {
+                case 1:
+                {
+                    return ShiftOr<1>::find(m_data, m_size, buf, size);
+                }
+                case 2:
+                {
+                    return ShiftOr<2>::find(m_data, m_size, buf, size);
+                }
+                case 4:
+                {
+                    return ShiftOr<4>::find(m_data, m_size, buf, size);
+                }
+                default:
+                {
+                    return nullptr;
+                }
+                }
+            }
+
+        private:
+            unsigned long long* m_data = nullptr;
+            size_t m_size = 0;
+            size_t m_words = 0;
+        };
+    };
+
+
+    // Pattern format in a template way:
+    // Sig::find<Sig::Byte<0x11, 0x22>, Sig::Char<'t', 'e', 'x', 't'>, Sig::Dword<>, Sig::Byte<0xFF>>(arr, sizeof(arr));
+    template <typename... Entries>
+    static const void* find(const void* const buf, const size_t size)
+    {
+        return findRanked<X64Frequency, Entries...>(buf, size);
+    }
+
+    // The same with a custom table of byte frequencies (any type with the static constexpr k_table[256] like Sig::X64Frequency),
+    // the rarest bytes are taken as anchors and entries are compared from the least likely to match:
+    // Sig::findRanked<MyFrequency, Sig::Byte<0x48, 0x8B>, Sig::Dword<>, Sig::Byte<0xC3>>(arr, sizeof(arr));
+    template <typename Frequency, typename... Entries>
+    static const void* findRanked(const void* const buf, const size_t size)
+    {
+        constexpr auto k_patternSize = (Entries::k_size + ...);
+
+        sig_stats(const Stats::Scan scan(size, k_patternSize));
+
+        if (size < k_patternSize)
+        {
+            return nullptr;
+        }
+
+        const auto* pos = static_cast<const unsigned char*>(buf);
+        const auto* const end = static_cast<const unsigned char*>(buf) + size - k_patternSize + 1;
+
+        using PatternAnchors = Anchors<Frequency, Entries...>;
+        if constexpr (ByteRun<Entries...>::k_exists)
+        {
+            return ByteRun<Entries...>::find(pos, end);
+        }
+        else if constexpr (PatternAnchors::k_exists)
+        {
+            return Simd::dispatch([pos, end](auto vec) -> const unsigned char*
+            {
+                return Simd::findPair<decltype(vec)>(
+                    pos,
+                    end,
+                    PatternAnchors::k_first,
+                    PatternAnchors::k_layout.val[PatternAnchors::k_first],
+                    PatternAnchors::k_last,
+                    PatternAnchors::k_layout.val[PatternAnchors::k_last],
+                    [](const unsigned char* const candidate) -> bool
+                    {
+                        sig_stats(Stats::candidate());
+                        return FusedComparator<Frequency, Entries...>::cmp(candidate);
+                    }
+                );
+            });
+        }
+        else
+        {
+            while (pos < end)
+            {
+                sig_stats(Stats::candidate());
+                const bool equals = FusedComparator<Frequency, Entries...>::cmp(pos);
+                if (equals)
+                {
+                    return pos;
+                }
+
+                ++pos;
+            }
+
+            return nullptr;
+        }
+    }
+
+
+#if sig_has_cxx20
+    template <String str>
+    struct StrEq : Str<str>
+    {
+        static bool cmp(const void* const pos)
+        {
+            using Char = typename decltype(str)::Type;
+
+            const auto* const mem = static_cast<const unsigned char*>(pos);
+            for (size_t i = 0; i < decltype(str)::k_len; ++i)
+            {
+                if (load<Char>(mem + i * sizeof(Char)) != str.str.buf[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    };
+
+    template <String str>
+    struct StrEqNoCase : Str<str>
+    {
+        static bool cmp(const void* const pos)
+        {
+            using Char = typename decltype(str)::Type;
+
+            const auto* const mem = static_cast<const unsigned char*>(pos);
+            for (size_t i = 0; i < decltype(str)::k_len; ++i)
+            {
+                const auto low = [](const Char ch) -> Char
+                {
+                    return ((ch >= static_cast<Char>('A')) && (ch <= static_cast<Char>('Z')))
+                        ? (ch + static_cast<Char>('a' - 'A'))
+                        : (ch);
+                };
+
+                const auto left = low(load<Char>(mem + i * sizeof(Char)));
+                const auto right = low(str.str.buf[i]);
+
+                if (left != right)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    };
+#endif
+
+
+    template <typename Type, Type value, Type mask>
+    struct BitMask : RawCmp<Type>
+    {
+        static bool cmp(const void* const pos)
+        {
+            return (load<Type>(pos) & mask) == (value & mask);
+        }
+    };
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, char... values>
+    using CmpChar = Holder<char, Comparator, values...>;
+
+    template <char... values>
+    using Char = CmpChar<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, wchar_t... values>
+    using CmpWChar = Holder<wchar_t, Comparator, values...>;
+
+    template <wchar_t... values>
+    using WChar = CmpWChar<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned char... values>
+    using CmpByte = Holder<unsigned char, Comparator, values...>;
+
+    template <unsigned char... values>
+    using Byte = CmpByte<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned short... values>
+    using CmpWord = Holder<unsigned short, Comparator, values...>;
+
+    template <unsigned short... values>
+    using Word = CmpWord<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned int... values>
+    using CmpDword = Holder<unsigned int, Comparator, values...>;
+
+    template <unsigned int... values>
+    using Dword = CmpDword<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned long long... values>
+    using CmpQword = Holder<unsigned long long, Comparator, values...>;
+
+    template <unsigned long long... values>
+    using Qword = CmpQword<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, short... values>
+    using CmpShort = Holder<short, Comparator, values...>;
+
+    template <short... values>
+    using Short = CmpShort<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned short... values>
+    using CmpUShort = Holder<unsigned short, Comparator, values...>;
+
+    template <unsigned short... values>
+    using UShort = CmpUShort<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, long... values>
+    using CmpLong = Holder<long, Comparator, values...>;
+
+    template <long... values>
+    using Long = CmpLong<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned long... values>
+    using CmpULong = Holder<unsigned long, Comparator, values...>;
+
+    template <unsigned long... values>
+    using ULong = CmpULong<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, long long... values>
+    using CmpLongLong = Holder<long long, Comparator, values...>;
+
+    template <long long... values>
+    using LongLong = CmpLongLong<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned long long... values>
+    using CmpULongLong = Holder<unsigned long long, Comparator, values...>;
+
+    template <unsigned long long... values>
+    using ULongLong = CmpULongLong<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, int... values>
+    using CmpInt = Holder<int, Comparator, values...>;
+
+    template <int... values>
+    using Int = CmpInt<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned int... values>
+    using CmpUInt = Holder<unsigned int, Comparator, values...>;
+
+    template <unsigned int... values>
+    using UInt = CmpUInt<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, long long... values>
+    using CmpInt64 = Holder<long long, Comparator, values...>;
+
+    template <long long... values>
+    using Int64 = CmpInt64<Cmp::Eq, values...>;
+
+
+    template <template <typename BaseType, BaseType val> typename Comparator, unsigned long long... values>
+    using CmpUInt64 = Holder<unsigned long long, Comparator, values...>;
+
+    template <unsigned long long... values>
+    using UInt64 = CmpUInt64<Cmp::Eq, values...>;
+
+
+
+    template <unsigned char value, unsigned char mask>
+    using ByteMask = BitMask<unsigned char, value, mask>;
+
+    template <unsigned short value, unsigned short mask>
+    using WordMask = BitMask<unsigned short, value, mask>;
+
+    template <unsigned int value, unsigned int mask>
+    using DwordMask = BitMask<unsigned int, value, mask>;
+
+    template <unsigned long long value, unsigned long long mask>
+    using QwordMask = BitMask<unsigned long long, value, mask>;
+
+
+
+    struct Mask
+    {
+        enum class CmpType
+        {
+            basic,
+            extended
+        };
+
+        // How the comparator is expressed in the value/mask form of Sig::PatternView:
+        enum class Lowering
+        {
+            none,  // Can't be expressed
+            exact, // (data == pattern)
+            any,   // Any byte
+            bits   // (data & subpattern) == (pattern & subpattern)
+        };
+
+        template <char ch>
+        struct MaskCmp
+        {
+            static constexpr auto k_char = ch;
+            static constexpr auto k_type = CmpType::basic;
+            static constexpr auto k_lowering = Lowering::none;
+        };
+
+        template <char ch>
+        struct MaskCmpEx
+        {
+            static constexpr auto k_char = ch;
+            static constexpr auto k_type = CmpType::extended;
+            static constexpr auto k_lowering = Lowering::none;
+        };
+
+        template <char ch>
+        struct Eq : MaskCmp<ch>
+        {
+            static constexpr auto k_lowering = Lowering::exact;
+
+            static bool cmp(const char data, const char pattern)
+            {
+                return data == pattern;
+            }
+        };
+
+        template <char ch>
+        struct NotEq : MaskCmp<ch>
+        {
+            static bool cmp(const char data, const char pattern)
+            {
+                return data != pattern;
+            }
+        };
+
+        template <char ch>
+        struct Gr : MaskCmp<ch>
+        {
+            static bool cmp(const char data, const char pattern)
+            {
+                return data > pattern;
+            }
+        };
+
+        template <char ch>
+        struct GrEq : MaskCmp<ch>
+        {
+            static bool cmp(const char data, const char pattern)
+            {
+                return data >= pattern;
+            }
+        };
+
+        template <char ch>
+        struct Le : MaskCmp<ch>
+        {
+            static bool cmp(const char data, const char pattern)
+            {
+                return data < pattern;
+            }
+        };
+
+        template <char ch>
+        struct LeEq : MaskCmp<ch>
+        {
+            static bool cmp(const char data, const char pattern)
+            {
+                return data <= pattern;
+            }
+        };
+
+        template <char ch>
+        struct OneOf : MaskCmp<ch>
+        {
+            static bool cmp(const char data, const char pattern)
+            {
+                return (data & pattern) != 0;
+            }
+        };
+
+        template <char ch>
+        struct AllOf : MaskCmp<ch>
+        {
+            static bool cmp(const char data, const char pattern)
+            {
+                return (data & pattern) == pattern;
+            }
+        };
+
+        template <char ch>
+        struct BitMask : MaskCmpEx<ch>
+        {
+            static constexpr auto k_lowering = Lowering::bits;
+
+            static bool cmp(const char data, const char pattern, const char subpattern)
+            {
+                return (data & subpattern) == (pattern & subpattern);
+            }
+        };
+
+        template <char ch>
+        struct Any : MaskCmp<ch>
+        {
+            static constexpr auto k_lowering = Lowering::any;
+
+            static bool cmp(const char, const char)
+            {
+                return true;
+            }
+        };
+    };
+
+    template <typename... Entries>
+    struct MaskComparator
+    {
+    };
+
+    template <typename Entry, typename... Entries>
+    struct MaskComparator<Entry, Entries...>
+    {
+        static bool cmp(const char data, const char pattern, const char mask)
+        {
+            if (mask == Entry::k_char)
+            {
+                return Entry::cmp(data, pattern);
+            }
+            else
+            {
+                return MaskComparator<Entries...>::cmp(data, pattern, mask);
+            }
+        }
+
+        static bool cmp(const char data, const char pattern, const char subpattern, const char mask)
+        {
+            if (mask == Entry::k_char)
+            {
+                if constexpr (Entry::k_type == Mask::CmpType::basic)
+                {
+                    return Entry::cmp(data, pattern);
+                }
+                else if constexpr (Entry::k_type == Mask::CmpType::extended)
+                {
+                    return Entry::cmp(data, pattern, subpattern);
+                }
+                else
+                {
+                    static_assert("Unknown type of comparator");
+                }
+            }
+            else
+            {
+                return MaskComparator<Entries...>::cmp(data, pattern, subpattern, mask);
+            }
+        }
+
+        static Mask::Lowering lowering(const char mask)
+        {
+            if (mask == Entry::k_char)
+            {
+                return Entry::k_lowering;
+            }
+            else
+            {
+                return MaskComparator<Entries...>::lowering(mask);
+            }
+        }
+    };
+
+
+
+    // Pattern format: "\x11\x2\x00text" + "..?....", meaning of mask chars is customizable by Sig:Mask::* types
+    template <typename... Comparators>
+    static const void* find(const void* const buf, const size_t size, const char* const sig, const char* const mask, const size_t sigsize)
+    {
+        if (!size || !sig || !mask || (size < sigsize))
+        {
+            return nullptr;
+        }
+
+        if (!sigsize)
+        {
+            return buf;
+        }
+
+        const MaskProgram<Comparators...> program(sig, nullptr, mask, sigsize, MaskProgram<Comparators...>::Usage::once);
+        return program.find(buf, size);
+    }
+
+    // Pattern format: "\x11\x2\x00text" + "..?....", meaning of mask chars is customizable by Sig::Mask::* types
+    template <typename... Comparators>
+    static const void* find(const void* const buf, const size_t size, const char* const sig, const char* const mask)
+    {
+        if (!mask)
+        {
+            return nullptr;
+        }
+
+        return find<Comparators...>(buf, size, sig, mask, strlen(mask));
+    }
+
+    // Pattern format: "\x11\x2\x00text" + nullptr/"....\x1C\x03." + "..?.mm.", meaning of mask chars is customizable by Sig:Mask::* types
+    template <typename... Comparators>
+    static const void* find(const void* const buf, const size_t size, const char* const sig, const char* const subsig, const char* const mask, const size_t sigsize)
+    {
+        if (!sig || !subsig || !mask || (size < sigsize))
+        {
+            return nullptr;
+        }
+
+        if (!sigsize)
+        {
+            return buf;
+        }
+
+        const MaskProgram<Comparators...> program(sig, subsig, mask, sigsize, MaskProgram<Comparators...>::Usage::once);
+        return program.find(buf, size);
+    }
 
-    template <typename Type, Type value, Type mask>
-    struct BitMask : RawCmp<Type>
+    // Pattern format: "\x11\x2\x00text" + "..?....", meaning of mask chars is customizable by Sig::Mask::* types
+    template <typename... Comparators>
+    static const void* find(const void* const buf, const size_t size, const char* const sig, const char* const subsig, const char* const mask)
     {
-        static bool cmp(const void* const pos)
+        if (!mask)
+        {
+            return nullptr;
+        }
+
+        return find<Comparators...>(buf, size, sig, subsig, mask, strlen(mask));
+    }
+
+    // Pattern format: sig ("\x0D\xCB\xFF") + valuable bits in the sig that must match ("\x0D\xFF\x03")
+    static const void* bitmask(const void* const buf, const size_t size, const void* const sig, const void* const mask, size_t sigsize)
+    {
+        return bitmask(buf, size, sig, mask, sigsize, nullptr);
+    }
+
+    // The same with the Shift-Or table that was built once for the pattern (or nullptr), it is used by the scalar kernel:
+    static const void* bitmask(const void* const buf, const size_t size, const void* const sig, const void* const mask, size_t sigsize, const Bitap::Table* const table)
+    {
+        sig_stats(const Stats::Scan scan(size, sigsize));
+
+        if (!sig || !mask || !sigsize || (size < sigsize))
+        {
+            return nullptr;
+        }
+
+        const auto* const val = static_cast<const unsigned char*>(sig);
+        const auto* const msk = static_cast<const unsigned char*>(mask);
+
+        const auto anchored = [buf, size, val, msk, sigsize]() -> const void*
+        {
+            return Simd::dispatch([buf, size, val, msk, sigsize](auto vec) -> const unsigned char*
+            {
+                return Simd::findMasked<decltype(vec)>(static_cast<const unsigned char*>(buf), size, val, msk, sigsize);
+            });
+        };
+
+        if (table && table->valid() && (isa() == Isa::scalar))
         {
-            return (*static_cast<const Type*>(pos) & mask) == (value & mask);
+            return table->find(static_cast<const unsigned char*>(buf), size);
+        }
+
+        if (Bitap::preferred(msk, sigsize, size))
+        {
+            const auto build = [val, msk, sigsize](auto& table)
+            {
+                Bitap::allowMasked(table, val, msk, sigsize);
+            };
+
+            return Bitap::find(static_cast<const unsigned char*>(buf), size, sigsize, build, anchored);
+        }
+
+        return anchored();
+    }
+
+    // Compiled form of a runtime pattern: the byte at [i] matches when (pos[i] & msk[i]) == (val[i] & msk[i]):
+    struct PatternView
+    {
+        const unsigned char* val;
+        const unsigned char* msk;
+        size_t size;
+        const Bitap::Table* table = nullptr;
+
+        size_t patternSize() const
+        {
+            return size;
+        }
+
+        const void* find(const void* const buf, const size_t bufSize) const
+        {
+            return bitmask(buf, bufSize, val, msk, size, table);
         }
     };
 
+    // Parser of the one-line format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF":
+    struct OneLine
+    {
+        static constexpr const char* skipSpace(const char* const str)
+        {
+            const char* pos = str;
+            while ((*pos == ' ') || (*pos == '\t'))
+            {
+                ++pos;
+            }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, char... values>
-    using CmpChar = Holder<char, Comparator, values...>;
+            return pos;
+        }
 
-    template <char... values>
-    using Char = CmpChar<Cmp::Eq, values...>;
+        static constexpr size_t calcTokenLen(const char* const str)
+        {
+            size_t size = 0;
+            while ((str[size]) && (str[size] != ' ') && (str[size] != '\t'))
+            {
+                ++size;
+            }
+            return size;
+        }
 
+        static constexpr bool isHexChar(const char ch)
+        {
+            return ((ch >= '0') && (ch <= '9')) || ((ch >= 'A') && (ch <= 'F')) || ((ch >= 'a') && (ch <= 'f'));
+        }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, wchar_t... values>
-    using CmpWChar = Holder<wchar_t, Comparator, values...>;
+        static constexpr unsigned char charToByte(const char ch)
+        {
+            if (ch >= '0' && ch <= '9')
+            {
+                return static_cast<unsigned char>(ch - '0');
+            }
 
-    template <wchar_t... values>
-    using WChar = CmpWChar<Cmp::Eq, values...>;
+            if (ch >= 'A' && ch <= 'F')
+            {
+                return static_cast<unsigned char>(ch - 'A' + 10);
+            }
 
+            if (ch >= 'a' && ch <= 'f')
+            {
+                return static_cast<unsigned char>(ch - 'a' + 10);
+            }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned char... values>
-    using CmpByte = Holder<unsigned char, Comparator, values...>;
+            return 0;
+        }
 
-    template <unsigned char... values>
-    using Byte = CmpByte<Cmp::Eq, values...>;
+        // Returns the count of bytes in the pattern or zero if the pattern is malformed:
+        static constexpr size_t calcSigBytes(const char* const sig)
+        {
+            if (!sig)
+            {
+                return 0;
+            }
 
+            const char* pos = sig;
+            size_t bytes = 0;
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned short... values>
-    using CmpWord = Holder<unsigned short, Comparator, values...>;
+            while (*(pos = skipSpace(pos)) != '\0')
+            {
+                ++bytes;
+                const size_t entryLen = calcTokenLen(pos);
+                constexpr auto k_maxTokenSize = (sizeof("xx") - sizeof('\0'));
+                if (entryLen > k_maxTokenSize)
+                {
+                    return 0;
+                }
 
-    template <unsigned short... values>
-    using Word = CmpWord<Cmp::Eq, values...>;
+                if (entryLen == k_maxTokenSize)
+                {
+                    if ((pos[0] == '?') || (pos[1] == '?'))
+                    {
+                        if (pos[0] != pos[1])
+                        {
+                            return 0;
+                        }
+                    }
+                    else
+                    {
+                        if (!isHexChar(pos[0]) || !isHexChar(pos[1]))
+                        {
+                            return 0;
+                        }
+                    }
+                }
+                else if (entryLen == sizeof('x'))
+                {
+                    if ((pos[0] != '?') && !isHexChar(pos[0]))
+                    {
+                        return 0;
+                    }
+                }
 
+                pos += entryLen;
+            }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned int... values>
-    using CmpDword = Holder<unsigned int, Comparator, values...>;
+            return bytes;
+        }
 
-    template <unsigned int... values>
-    using Dword = CmpDword<Cmp::Eq, values...>;
+        // Fills the val/msk arrays and returns the count of bytes or zero if the pattern is malformed or doesn't fit the capacity:
+        static constexpr size_t parse(const char* const sig, unsigned char* const val, unsigned char* const msk, const size_t capacity)
+        {
+            const size_t sigBytes = calcSigBytes(sig);
+            if (!sigBytes || (sigBytes > capacity))
+            {
+                return 0;
+            }
 
+            parseTokens(sig, val, msk, sigBytes);
+            return sigBytes;
+        }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned long long... values>
-    using CmpQword = Holder<unsigned long long, Comparator, values...>;
+        // Fills the val/msk arrays by the first count tokens of the well-formed pattern and returns the rest of the pattern:
+        static constexpr const char* parseTokens(const char* const sig, unsigned char* const val, unsigned char* const msk, const size_t count)
+        {
+            const char* pos = sig;
+            for (size_t i = 0; i < count; ++i)
+            {
+                pos = skipSpace(pos);
+                const size_t tokenSize = calcTokenLen(pos);
 
-    template <unsigned long long... values>
-    using Qword = CmpQword<Cmp::Eq, values...>;
+                if (*pos == '?')
+                {
+                    val[i] = 0x00;
+                    msk[i] = 0x00;
+                }
+                else
+                {
+                    val[i] = tokenToByte(pos, tokenSize);
+                    msk[i] = 0xFF;
+                }
 
+                pos += tokenSize;
+            }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, short... values>
-    using CmpShort = Holder<short, Comparator, values...>;
+            return pos;
+        }
 
-    template <short... values>
-    using Short = CmpShort<Cmp::Eq, values...>;
+        // Compares the well-formed pattern with the data token by token:
+        static bool matches(const char* const sig, const unsigned char* const data, const size_t count)
+        {
+            const char* pos = sig;
+            for (size_t i = 0; i < count; ++i)
+            {
+                pos = skipSpace(pos);
+                const size_t tokenSize = calcTokenLen(pos);
+                if ((*pos != '?') && (data[i] != tokenToByte(pos, tokenSize)))
+                {
+                    return false;
+                }
 
+                pos += tokenSize;
+            }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned short... values>
-    using CmpUShort = Holder<unsigned short, Comparator, values...>;
+            return true;
+        }
 
-    template <unsigned short... values>
-    using UShort = CmpUShort<Cmp::Eq, values...>;
+        static constexpr unsigned char tokenToByte(const char* const token, const size_t tokenSize)
+        {
+            return (tokenSize == 2)
+                ? static_cast<unsigned char>((charToByte(token[0]) << 4) | charToByte(token[1]))
+                : charToByte(token[0]);
+        }
+    };
 
+    // One-line pattern compiled into the inline storage without any allocations, it is invalid if the pattern doesn't fit the capacity:
+    template <size_t capacity>
+    struct FixedPattern
+    {
+        static constexpr auto k_capacity = capacity;
 
-    template <template <typename BaseType, BaseType val> typename Comparator, long... values>
-    using CmpLong = Holder<long, Comparator, values...>;
+        unsigned char val[k_capacity]{};
+        unsigned char msk[k_capacity]{};
+        size_t size = 0;
 
-    template <long... values>
-    using Long = CmpLong<Cmp::Eq, values...>;
+        FixedPattern() = default;
 
+        explicit FixedPattern(const char* const sig) : size(OneLine::parse(sig, val, msk, k_capacity))
+        {
+        }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned long... values>
-    using CmpULong = Holder<unsigned long, Comparator, values...>;
+        bool valid() const
+        {
+            return size != 0;
+        }
 
-    template <unsigned long... values>
-    using ULong = CmpULong<Cmp::Eq, values...>;
+        size_t patternSize() const
+        {
+            return size;
+        }
 
+        PatternView view() const
+        {
+            return PatternView{ val, msk, size };
+        }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, long long... values>
-    using CmpLongLong = Holder<long long, Comparator, values...>;
+        operator PatternView() const
+        {
+            return view();
+        }
 
-    template <long long... values>
-    using LongLong = CmpLongLong<Cmp::Eq, values...>;
+        const void* find(const void* const buf, const size_t bufSize) const
+        {
+            return view().find(buf, bufSize);
+        }
+    };
+
+#if !defined(_KERNEL_MODE)
+    // One-line pattern compiled into the heap storage of any length (kernelmode builds have no operator new, so they have only Sig::FixedPattern):
+    struct Pattern
+    {
+        Pattern() = default;
+
+        explicit Pattern(const char* const sig)
+        {
+            const size_t sigBytes = OneLine::calcSigBytes(sig);
+            if (!sigBytes)
+            {
+                return;
+            }
+
+            m_storage = new (std::nothrow) unsigned char[sigBytes * 2];
+            if (!m_storage)
+            {
+                return;
+            }
+
+            m_size = OneLine::parse(sig, &m_storage[0], &m_storage[sigBytes], sigBytes);
+
+            // The scalar kernel searches by the Shift-Or table, so it is built once here:
+            const unsigned char* const val = &m_storage[0];
+            const unsigned char* const msk = &m_storage[sigBytes];
+            if (m_size && Bitap::suits(msk, m_size))
+            {
+                m_table.build(m_size, [val, msk, sigBytes](Bitap::Table& table)
+                {
+                    Bitap::allowMasked(table, val, msk, sigBytes);
+                });
+            }
+        }
+
+        Pattern(const Pattern&) = delete;
+
+        Pattern(Pattern&& pattern) noexcept : m_storage(pattern.m_storage), m_size(pattern.m_size), m_table(std::move(pattern.m_table))
+        {
+            pattern.m_storage = nullptr;
+            pattern.m_size = 0;
+        }
+
+        ~Pattern()
+        {
+            delete[] m_storage;
+        }
+
+        Pattern& operator = (const Pattern&) = delete;
+
+        Pattern& operator = (Pattern&& pattern) noexcept
+        {
+            if (&pattern == this)
+            {
+                return *this;
+            }
+
+            delete[] m_storage;
+
+            m_storage = pattern.m_storage;
+            m_size = pattern.m_size;
+            m_table = std::move(pattern.m_table);
+
+            pattern.m_storage = nullptr;
+            pattern.m_size = 0;
+
+            return *this;
+        }
+
+        bool valid() const
+        {
+            return m_size != 0;
+        }
+
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        size_t patternSize() const
+        {
+            return m_size;
+        }
+
+        PatternView view() const
+        {
+            return PatternView{ m_storage, m_storage + m_size, m_size, &m_table };
+        }
 
+        operator PatternView() const
+        {
+            return view();
+        }
+
+        const void* find(const void* const buf, const size_t bufSize) const
+        {
+            return view().find(buf, bufSize);
+        }
+
+    private:
+        unsigned char* m_storage = nullptr;
+        size_t m_size = 0;
+        Bitap::Table m_table;
+    };
+#endif
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned long long... values>
-    using CmpULongLong = Holder<unsigned long long, Comparator, values...>;
+    // Patterns up to this size are compiled on the stack by the one-line Sig::find:
+    static constexpr size_t k_inlinePatternCapacity = 256;
 
-    template <unsigned long long... values>
-    using ULongLong = CmpULongLong<Cmp::Eq, values...>;
+    // Pattern format: a compiled pattern (Sig::Pattern, Sig::FixedPattern<capacity> or Sig::PatternView)
+    static const void* find(const void* const buf, const size_t size, const PatternView& pattern)
+    {
+        return pattern.find(buf, size);
+    }
 
+    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF" ('?' and '??' have the same meaning: any byte)
+    static const void* find(const void* const buf, const size_t size, const char* const sig)
+    {
+        const size_t sigBytes = OneLine::calcSigBytes(sig);
+        if (!sigBytes)
+        {
+            return nullptr;
+        }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, int... values>
-    using CmpInt = Holder<int, Comparator, values...>;
+        if (sigBytes <= k_inlinePatternCapacity)
+        {
+            const FixedPattern<k_inlinePatternCapacity> pattern(sig);
+            return pattern.find(buf, size);
+        }
 
-    template <int... values>
-    using Int = CmpInt<Cmp::Eq, values...>;
+#if defined(_KERNEL_MODE)
+        // Longer patterns can't be compiled without the heap, so their head is searched and the rest is compared by tokens:
+        if (size < sigBytes)
+        {
+            return nullptr;
+        }
 
+        unsigned char val[k_inlinePatternCapacity];
+        unsigned char msk[k_inlinePatternCapacity];
+        const char* const tail = OneLine::parseTokens(sig, val, msk, k_inlinePatternCapacity);
+        const PatternView head{ val, msk, k_inlinePatternCapacity };
+        const size_t tailBytes = sigBytes - k_inlinePatternCapacity;
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned int... values>
-    using CmpUInt = Holder<unsigned int, Comparator, values...>;
+        const auto* pos = static_cast<const unsigned char*>(buf);
+        const auto* const end = pos + size - tailBytes;
+        while (pos < end)
+        {
+            const auto* const found = static_cast<const unsigned char*>(head.find(pos, static_cast<size_t>(end - pos)));
+            if (!found)
+            {
+                return nullptr;
+            }
 
-    template <unsigned int... values>
-    using UInt = CmpUInt<Cmp::Eq, values...>;
+            if (OneLine::matches(tail, found + k_inlinePatternCapacity, tailBytes))
+            {
+                return found;
+            }
 
+            pos = found + 1;
+        }
 
-    template <template <typename BaseType, BaseType val> typename Comparator, long long... values>
-    using CmpInt64 = Holder<long long, Comparator, values...>;
+        return nullptr;
+#else
+        const Pattern pattern(sig);
+        return pattern.find(buf, size);
+#endif
+    }
 
-    template <long long... values>
-    using Int64 = CmpInt64<Cmp::Eq, values...>;
+#if sig_has_cxx20
+    // One-line pattern parsed in compile-time, malformed patterns fail the compilation:
+    template <String sig>
+    struct PatLayout
+    {
+        static_assert(std::is_same_v<typename decltype(sig)::Type, char>, "One-line patterns must be narrow strings");
 
+        static constexpr auto parse()
+        {
+            constexpr size_t k_capacity = (decltype(sig)::k_len != 0) ? decltype(sig)::k_len : 1;
 
-    template <template <typename BaseType, BaseType val> typename Comparator, unsigned long long... values>
-    using CmpUInt64 = Holder<unsigned long long, Comparator, values...>;
+            char text[decltype(sig)::k_len + 1]{};
+            for (size_t i = 0; i < decltype(sig)::k_len; ++i)
+            {
+                text[i] = sig.str.buf[i];
+            }
 
-    template <unsigned long long... values>
-    using UInt64 = CmpUInt64<Cmp::Eq, values...>;
+            Layout<k_capacity> layout{};
+            layout.size = OneLine::parse(text, layout.val, layout.msk, k_capacity);
+            return layout;
+        }
 
+        static constexpr auto k_layout = parse();
+        static_assert(k_layout.size != 0, "Malformed one-line pattern");
 
+        template <size_t index>
+        using Entry = std::conditional_t<(k_layout.msk[index] != 0), Holder<unsigned char, Cmp::Eq, k_layout.val[index]>, Holder<unsigned char, Cmp::Eq>>;
+    };
 
-    template <unsigned char value, unsigned char mask>
-    using ByteMask = BitMask<unsigned char, value, mask>;
+    template <String sig, size_t index, size_t size, typename... Entries>
+    struct PatBuilder
+    {
+        using Type = typename PatBuilder<sig, index + 1, size, Entries..., typename PatLayout<sig>::template Entry<index>>::Type;
+    };
 
-    template <unsigned short value, unsigned short mask>
-    using WordMask = BitMask<unsigned short, value, mask>;
+    template <String sig, size_t size, typename... Entries>
+    struct PatBuilder<sig, size, size, Entries...>
+    {
+        using Type = Compound<Entries...>;
+    };
 
-    template <unsigned int value, unsigned int mask>
-    using DwordMask = BitMask<unsigned int, value, mask>;
+    // One-line pattern in a template way: Sig::find<Sig::Pat<"48 8B ? ? 89 05">>(buf, size)
+    // It is expanded in compile-time into a Sig::Compound of single-byte entries, one per token:
+    // Sig::Compound<Sig::Byte<0x48>, Sig::Byte<0x8B>, Sig::Byte<>, Sig::Byte<>, Sig::Byte<0x89>, Sig::Byte<0x05>>:
+    template <String sig>
+    using Pat = typename PatBuilder<sig, 0, PatLayout<sig>::k_layout.size>::Type;
+#endif
 
-    template <unsigned long long value, unsigned long long mask>
-    using QwordMask = BitMask<unsigned long long, value, mask>;
 
 
+    // Searchers bring all pattern formats to the common interface used by Sig::findAll and the scanners:
+    //   size_t patternSize() const: count of bytes that the pattern needs starting from the match;
+    //   const void* find(const void* buf, size_t size) const: the first match in the buffer or nullptr.
+    // Sig::PatternView, Sig::FixedPattern<capacity> and Sig::Pattern are searchers as well.
 
-    struct Mask
+    template <typename... Entries>
+    struct TemplateSearcher
     {
-        enum class CmpType
+        static constexpr size_t patternSize()
         {
-            basic,
-            extended
-        };
+            return (Entries::k_size + ...);
+        }
 
-        template <char ch>
-        struct MaskCmp
+        const void* find(const void* const buf, const size_t size) const
         {
-            static constexpr auto k_char = ch;
-            static constexpr auto k_type = CmpType::basic;
-        };
+            return Sig::find<Entries...>(buf, size);
+        }
+    };
 
-        template <char ch>
-        struct MaskCmpEx
+    // Pattern + mask (or pattern + subpattern + mask) compiled once: masks of Sig::Mask::Eq, Sig::Mask::Any and Sig::Mask::BitMask
+    // are lowered into the value/mask form that is searched by Sig::bitmask, masks with other comparators are compiled into
+    // a table of opcodes (the index of the comparator for each position except wildcards) that is prefiltered by the two rarest exact bytes
+    // or, if there are less than two exact bytes, turned into classes of bytes for Sig::ShiftOr.
+    // Masks with unknown chars (and Sig::Mask::BitMask without the subpattern) are rejected here instead of at every position.
+    // Kernelmode builds have no heap, so masks that don't fit the inline storage are compared directly at every position:
+    template <typename... Comparators>
+    struct MaskProgram
+    {
+        enum class Form
         {
-            static constexpr auto k_char = ch;
-            static constexpr auto k_type = CmpType::extended;
+            invalid,
+            lowered,
+            opcodes,
+            direct
         };
 
-        template <char ch>
-        struct Eq : MaskCmp<ch>
+        // Programs that are reused build the Sig::ShiftOr table once, single scans build it on the stack if the buffer is long enough:
+        enum class Usage
         {
-            static bool cmp(const char data, const char pattern)
-            {
-                return data == pattern;
-            }
+            once,
+            repeated
         };
 
-        template <char ch>
-        struct NotEq : MaskCmp<ch>
+        MaskProgram(const char* const sig, const char* const subsig, const char* const mask, const size_t sigsize, const Usage usage = Usage::repeated)
         {
-            static bool cmp(const char data, const char pattern)
+            if (!sig || !mask || !sigsize)
             {
-                return data != pattern;
+                return;
             }
-        };
 
-        template <char ch>
-        struct Gr : MaskCmp<ch>
-        {
-            static bool cmp(const char data, const char pattern)
+            m_size = sigsize;
+
+            // Lowered masks need only the value/mask bytes, opcode programs need the instructions after them:
+            size_t instructions = 0;
+            const bool lowerable = measure(subsig, mask, instructions);
+            const size_t codeOffset = (sigsize * 2 + alignof(Instruction) - 1) / alignof(Instruction) * alignof(Instruction);
+            const size_t bytes = lowerable ? (sigsize * 2) : (codeOffset + instructions * sizeof(Instruction));
+
+            unsigned char* storage = m_inlineStorage;
+            if (bytes > sizeof(m_inlineStorage))
             {
-                return data > pattern;
+#if defined(_KERNEL_MODE)
+                m_form = validate(subsig, mask) ? Form::direct : Form::invalid;
+                m_sig = sig;
+                m_subsig = subsig;
+                m_mask = mask;
+                return;
+#else
+                m_storage = new (std::nothrow) unsigned char[bytes];
+                if (!m_storage)
+                {
+                    return;
+                }
+
+                storage = m_storage;
+#endif
             }
-        };
 
-        template <char ch>
-        struct GrEq : MaskCmp<ch>
-        {
-            static bool cmp(const char data, const char pattern)
+            m_val = storage;
+            m_msk = storage + sigsize;
+            if (lowerable)
             {
-                return data >= pattern;
+                m_form = lowerMask<Comparators...>(sig, subsig, mask, sigsize, m_val, m_msk) ? Form::lowered : Form::invalid;
             }
-        };
-
-        template <char ch>
-        struct Le : MaskCmp<ch>
-        {
-            static bool cmp(const char data, const char pattern)
+            else
             {
-                return data < pattern;
+                m_code = reinterpret_cast<Instruction*>(storage + codeOffset);
+                m_form = compile(sig, subsig, mask);
             }
-        };
 
-        template <char ch>
-        struct LeEq : MaskCmp<ch>
-        {
-            static bool cmp(const char data, const char pattern)
+            if ((usage == Usage::repeated) && (m_form == Form::opcodes) && (m_first == m_last))
             {
-                return data <= pattern;
+                m_table.build(m_size, [this](Bitap::Table& table)
+                {
+                    allowClasses(table);
+                });
             }
-        };
+        }
 
-        template <char ch>
-        struct OneOf : MaskCmp<ch>
+        MaskProgram(const MaskProgram&) = delete;
+        MaskProgram& operator = (const MaskProgram&) = delete;
+
+#if !defined(_KERNEL_MODE)
+        ~MaskProgram()
         {
-            static bool cmp(const char data, const char pattern)
+            delete[] m_storage;
+        }
+#endif
+
+        Form form() const
+        {
+            return m_form;
+        }
+
+        bool valid() const
+        {
+            return m_form != Form::invalid;
+        }
+
+        size_t patternSize() const
+        {
+            return m_size;
+        }
+
+        const void* find(const void* const buf, const size_t size) const
+        {
+            sig_stats(const Stats::Scan scan(size, m_size));
+
+            if ((m_form == Form::invalid) || (size < m_size))
             {
-                return (data & pattern) != 0;
+                return nullptr;
             }
-        };
 
-        template <char ch>
-        struct AllOf : MaskCmp<ch>
-        {
-            static bool cmp(const char data, const char pattern)
+            if (m_form == Form::lowered)
             {
-                return (data & pattern) == pattern;
+                return bitmask(buf, size, m_val, m_msk, m_size);
             }
-        };
 
-        template <char ch>
-        struct BitMask : MaskCmpEx<ch>
-        {
-            static bool cmp(const char data, const char pattern, const char subpattern)
+#if defined(_KERNEL_MODE)
+            if (m_form == Form::direct)
             {
-                return (data & subpattern) == (pattern & subpattern);
+                return findDirect(buf, size);
             }
-        };
+#endif
 
-        template <char ch>
-        struct Any : MaskCmp<ch>
-        {
-            static bool cmp(const char, const char)
+            const auto verify = [this](const unsigned char* const pos) -> bool
             {
+                sig_stats(Stats::candidate());
+
+                for (size_t i = 0; i < m_count; ++i)
+                {
+                    sig_stats(Stats::compare());
+
+                    const auto& instruction = m_code[i];
+                    const auto offset = instruction.offset;
+                    const bool matches = k_ops[instruction.op](static_cast<char>(pos[offset]), static_cast<char>(m_val[offset]), static_cast<char>(m_msk[offset]));
+                    if (!matches)
+                    {
+                        return false;
+                    }
+                }
+
                 return true;
+            };
+
+            const auto anchored = [this, buf, size, &verify]() -> const void*
+            {
+                const auto* pos = static_cast<const unsigned char*>(buf);
+                const auto* const end = pos + size - m_size + 1;
+
+                if (m_first != m_size)
+                {
+                    return Simd::dispatch([this, pos, end, &verify](auto vec) -> const unsigned char*
+                    {
+                        return Simd::findPair<decltype(vec)>(pos, end, m_first, m_val[m_first], m_last, m_val[m_last], verify);
+                    });
+                }
+
+                while (pos < end)
+                {
+                    if (verify(pos))
+                    {
+                        return pos;
+                    }
+
+                    ++pos;
+                }
+
+                return nullptr;
+            };
+
+            // Less than two exact bytes can't prefilter candidates, so every position becomes a class of bytes for Sig::ShiftOr:
+            if (m_table.valid())
+            {
+                return m_table.find(static_cast<const unsigned char*>(buf), size);
             }
-        };
-    };
 
-    template <typename... Entries>
-    struct MaskComparator
-    {
-    };
+            if ((m_first == m_last) && Bitap::fits(m_size, size))
+            {
+                const auto build = [this](auto& table)
+                {
+                    allowClasses(table);
+                };
 
-    template <typename Entry, typename... Entries>
-    struct MaskComparator<Entry, Entries...>
-    {
-        static bool cmp(const char data, const char pattern, const char mask)
+                return Bitap::find(static_cast<const unsigned char*>(buf), size, m_size, build, anchored);
+            }
+
+            return anchored();
+        }
+
+    private:
+        using Op = bool (*)(char data, char pattern, char subpattern);
+
+        struct Instruction
         {
-            if (mask == Entry::k_char)
+            unsigned int offset;
+            unsigned int op;
+        };
+
+        template <typename Comparator>
+        static bool invoke(const char data, const char pattern, const char subpattern)
+        {
+            if constexpr (Comparator::k_type == Mask::CmpType::extended)
             {
-                return Entry::cmp(data, pattern);
+                return Comparator::cmp(data, pattern, subpattern);
             }
             else
             {
-                return MaskComparator<Entries...>::cmp(data, pattern, mask);
+                return Comparator::cmp(data, pattern);
             }
         }
 
-        static bool cmp(const char data, const char pattern, const char subpattern, const char mask)
+        static constexpr size_t k_count = sizeof...(Comparators);
+        static constexpr Op k_ops[k_count + 1]{ &invoke<Comparators>..., nullptr };
+        static constexpr char k_chars[k_count + 1]{ Comparators::k_char..., '\0' };
+        static constexpr Mask::Lowering k_lowerings[k_count + 1]{ Comparators::k_lowering..., Mask::Lowering::none };
+        static constexpr bool k_extended[k_count + 1]{ (Comparators::k_type == Mask::CmpType::extended)..., false };
+
+        // The first comparator with the char wins as in Sig::MaskComparator:
+        static size_t opcode(const char ch)
         {
-            if (mask == Entry::k_char)
+            for (size_t op = 0; op < k_count; ++op)
             {
-                if constexpr (Entry::k_type == Mask::CmpType::basic)
+                if (k_chars[op] == ch)
                 {
-                    return Entry::cmp(data, pattern);
+                    return op;
                 }
-                else if constexpr (Entry::k_type == Mask::CmpType::extended)
+            }
+
+            return k_count;
+        }
+
+        template <typename Table>
+        void allowClasses(Table& table) const
+        {
+            size_t next = 0;
+            for (size_t i = 0; i < m_size; ++i)
+            {
+                const bool wildcard = (next == m_count) || (m_code[next].offset != i);
+                for (unsigned int byte = 0; byte < 256; ++byte)
                 {
-                    return Entry::cmp(data, pattern, subpattern);
+                    if (wildcard || k_ops[m_code[next].op](static_cast<char>(byte), static_cast<char>(m_val[i]), static_cast<char>(m_msk[i])))
+                    {
+                        table.allow(i, static_cast<unsigned char>(byte));
+                    }
                 }
-                else
+
+                if (!wildcard)
                 {
-                    static_assert("Unknown type of comparator");
+                    ++next;
                 }
             }
-            else
-            {
-                return MaskComparator<Entries...>::cmp(data, pattern, subpattern, mask);
-            }
         }
-    };
 
+        // Returns true if the mask can be lowered into the value/mask form and counts the positions that need an instruction otherwise:
+        bool measure(const char* const subsig, const char* const mask, size_t& instructions) const
+        {
+            bool lowerable = true;
+            instructions = 0;
+            for (size_t i = 0; i < m_size; ++i)
+            {
+                const auto lowering = k_lowerings[opcode(mask[i])];
+                if ((lowering == Mask::Lowering::none) || ((lowering == Mask::Lowering::bits) && !subsig))
+                {
+                    lowerable = false;
+                }
 
+                if (lowering != Mask::Lowering::any)
+                {
+                    ++instructions;
+                }
+            }
 
-    // Pattern format: "\x11\x2\x00text" + "..?....", meaning of mask chars is customizable by Sig:Mask::* types
-    template <typename... Comparators>
-    static const void* find(const void* const buf, const size_t size, const char* const sig, const char* const mask, const size_t sigsize)
-    {
-        if (!size || !sig || !mask)
-        {
-            return nullptr;
+            return lowerable;
         }
-
-        const auto* pos = static_cast<const unsigned char*>(buf);
-        const auto* const end = static_cast<const unsigned char*>(buf) + size - sigsize + 1;
-        while (pos < end)
+
+#if defined(_KERNEL_MODE)
+        bool validate(const char* const subsig, const char* const mask) const
         {
-            bool result = true;
-            for (size_t i = 0; i < sigsize; ++i)
+            for (size_t i = 0; i < m_size; ++i)
             {
-                const bool matches = MaskComparator<Comparators...>::cmp(pos[i], sig[i], mask[i]);
-                result &= matches;
-                if (!result)
+                const size_t op = opcode(mask[i]);
+                if ((op == k_count) || (k_extended[op] && !subsig))
                 {
-                    break;
+                    return false;
                 }
             }
 
-            if (result)
+            return true;
+        }
+
+        const void* findDirect(const void* const buf, const size_t size) const
+        {
+            const auto* pos = static_cast<const unsigned char*>(buf);
+            const auto* const end = pos + size - m_size + 1;
+            while (pos < end)
             {
-                return pos;
-            }
+                sig_stats(Stats::candidate());
 
-            ++pos;
-        }
+                bool result = true;
+                for (size_t i = 0; i < m_size; ++i)
+                {
+                    sig_stats(Stats::compare());
 
-        return nullptr;
-    }
+                    result = k_ops[opcode(m_mask[i])](static_cast<char>(pos[i]), m_sig[i], m_subsig ? m_subsig[i] : '\0');
+                    if (!result)
+                    {
+                        break;
+                    }
+                }
 
-    // Pattern format: "\x11\x2\x00text" + "..?....", meaning of mask chars is customizable by Sig::Mask::* types
-    template <typename... Comparators>
-    static const void* find(const void* const buf, const size_t size, const char* const sig, const char* const mask)
-    {
-        if (!mask)
-        {
-            return nullptr;
-        }
+                if (result)
+                {
+                    return pos;
+                }
 
-        return find<Comparators...>(buf, size, sig, mask, strlen(mask));
-    }
+                ++pos;
+            }
 
-    // Pattern format: "\x11\x2\x00text" + nullptr/"....\x1C\x03." + "..?.mm.", meaning of mask chars is customizable by Sig:Mask::* types
-    template <typename... Comparators>
-    static const void* find(const void* const buf, const size_t size, const char* const sig, const char* const subsig, const char* const mask, const size_t sigsize)
-    {
-        if (!sig || !subsig || !mask)
-        {
             return nullptr;
         }
+#endif
 
-        const auto* pos = static_cast<const unsigned char*>(buf);
-        const auto* const end = static_cast<const unsigned char*>(buf) + size - sigsize + 1;
-        while (pos < end)
+        Form compile(const char* const sig, const char* const subsig, const char* const mask)
         {
-            bool result = true;
-            for (size_t i = 0; i < sigsize; ++i)
+            m_count = 0;
+            for (size_t i = 0; i < m_size; ++i)
             {
-                const bool matches = MaskComparator<Comparators...>::cmp(pos[i], sig[i], subsig[i], mask[i]);
-                result &= matches;
-                if (!result)
+                const size_t op = opcode(mask[i]);
+                if ((op == k_count) || (k_extended[op] && !subsig))
                 {
-                    break;
+                    return Form::invalid;
+                }
+
+                m_val[i] = static_cast<unsigned char>(sig[i]);
+                m_msk[i] = subsig ? static_cast<unsigned char>(subsig[i]) : 0;
+
+                if (k_lowerings[op] != Mask::Lowering::any)
+                {
+                    m_code[m_count] = Instruction{ static_cast<unsigned int>(i), static_cast<unsigned int>(op) };
+                    ++m_count;
                 }
             }
 
-            if (result)
+            // Anchors are the two rarest exact bytes:
+            m_first = m_size;
+            m_last = m_size;
+            for (size_t i = 0; i < m_size; ++i)
             {
-                return pos;
+                if (k_lowerings[opcode(mask[i])] != Mask::Lowering::exact)
+                {
+                    continue;
+                }
+
+                const auto frequency = X64Frequency::k_table[m_val[i]];
+                if ((m_first == m_size) || (frequency < X64Frequency::k_table[m_val[m_first]]))
+                {
+                    m_last = m_first;
+                    m_first = i;
+                }
+                else if ((m_last == m_size) || (frequency < X64Frequency::k_table[m_val[m_last]]))
+                {
+                    m_last = i;
+                }
+            }
+
+            if (m_last == m_size)
+            {
+                m_last = m_first;
             }
 
-            ++pos;
+            return Form::opcodes;
         }
 
-        return nullptr;
-    }
+        // Only [0, size) of the values/masks and [0, count) of the instructions are read, so the storage isn't zeroed.
+        // It fits lowered masks of Sig::k_inlinePatternCapacity bytes and opcode programs with a part of their positions compared:
+        alignas(Instruction) unsigned char m_inlineStorage[k_inlinePatternCapacity * 4];
+#if defined(_KERNEL_MODE)
+        const char* m_sig = nullptr;
+        const char* m_subsig = nullptr;
+        const char* m_mask = nullptr;
+#else
+        unsigned char* m_storage = nullptr;
+#endif
+        unsigned char* m_val = nullptr;
+        unsigned char* m_msk = nullptr;
+        Instruction* m_code = nullptr;
+        size_t m_size = 0;
+        size_t m_count = 0;
+        size_t m_first = 0;
+        size_t m_last = 0;
+        Form m_form = Form::invalid;
+        Bitap::Table m_table;
+    };
 
-    // Pattern format: "\x11\x2\x00text" + "..?....", meaning of mask chars is customizable by Sig::Mask::* types
+    // Pattern + mask or pattern + subpattern + mask (if the subsig is not nullptr):
     template <typename... Comparators>
-    static const void* find(const void* const buf, const size_t size, const char* const sig, const char* const subsig, const char* const mask)
+    struct MaskSearcher
     {
-        if (!mask)
+        const char* sig;
+        const char* subsig;
+        const char* mask;
+        size_t sigsize;
+
+        size_t patternSize() const
         {
-            return nullptr;
+            return sigsize;
         }
 
-        return find<Comparators...>(buf, size, sig, subsig, mask, strlen(mask));
-    }
-
-    // Pattern format: sig ("\x0D\xCB\xFF") + valuable bits in the sig that must match ("\x0D\xFF\x03")
-    static const void* bitmask(const void* const buf, const size_t size, const void* const sig, const void* const mask, size_t sigsize)
-    {
-        if (!sig || !mask || !sigsize)
+        const void* find(const void* const buf, const size_t size) const
         {
-            return nullptr;
+            constexpr bool k_hasExtended = ((Comparators::k_type == Mask::CmpType::extended) || ...);
+            if constexpr (k_hasExtended)
+            {
+                return Sig::find<Comparators...>(buf, size, sig, subsig, mask, sigsize);
+            }
+            else
+            {
+                return subsig
+                    ? Sig::find<Comparators...>(buf, size, sig, subsig, mask, sigsize)
+                    : Sig::find<Comparators...>(buf, size, sig, mask, sigsize);
+            }
         }
+    };
 
-        const auto* const val = static_cast<const unsigned char*>(sig);
-        const auto* const msk = static_cast<const unsigned char*>(mask);
+    enum class Overlap
+    {
+        allowed, // The next match is searched from the byte after the previous match
+        denied   // The next match is searched from the end of the previous match
+    };
 
-        const auto* pos = static_cast<const unsigned char*>(buf);
-        const auto* const end = static_cast<const unsigned char*>(buf) + size - sigsize + 1;
-        while (pos < end)
+    // Lazy range of all matches, every step resumes the search after the previous match without any allocations:
+    template <typename Searcher>
+    struct Matches
+    {
+        struct Iterator
         {
-            bool result = true;
-            for (size_t i = 0; i < sigsize; ++i)
+            const Matches* matches;
+            const void* pos;
+
+            const void* operator * () const
             {
-                const bool matches = ((pos[i] & msk[i]) == (val[i] & msk[i]));
-                result &= matches;
-                if (!result)
-                {
-                    break;
-                }
+                return pos;
             }
 
-            if (result)
+            Iterator& operator ++ ()
             {
-                return pos;
+                pos = matches->next(pos);
+                return *this;
             }
 
-            ++pos;
-        }
+            bool operator == (const Iterator& iterator) const
+            {
+                return pos == iterator.pos;
+            }
 
-        return nullptr;
-    }
+            bool operator != (const Iterator& iterator) const
+            {
+                return pos != iterator.pos;
+            }
+        };
 
-    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF" ('?' and '??' have the same meaning: any byte)
-    static const void* find(const void* const buf, const size_t size, const char* const sig)
-    {
-        if (!sig)
+        Searcher searcher;
+        const void* buf;
+        size_t size;
+        Overlap overlap;
+
+        const void* first() const
         {
-            return nullptr;
+            return searcher.find(buf, size);
         }
 
-        const auto skipSpace = [](const char* const str) -> const char*
+        // The next match after the found one:
+        const void* next(const void* const found) const
         {
-            const char* pos = str;
-            while ((*pos == ' ') || (*pos == '\t'))
+            const size_t step = ((overlap == Overlap::denied) && searcher.patternSize()) ? searcher.patternSize() : 1;
+
+            const auto* const from = static_cast<const unsigned char*>(found) + step;
+            const auto* const end = static_cast<const unsigned char*>(buf) + size;
+            if (from > end)
             {
-                ++pos;
+                return nullptr;
             }
 
-            return pos;
-        };
+            return searcher.find(from, static_cast<size_t>(end - from));
+        }
 
-        const auto calcTokenLen = [](const char* const str) -> size_t
+        Iterator begin() const
         {
-            size_t size = 0;
-            while ((str[size]) && (str[size] != ' ') && (str[size] != '\t'))
-            {
-                ++size;
-            }
-            return size;
-        };
+            return Iterator{ this, first() };
+        }
 
-        const auto calcSigBytes = [&skipSpace, &calcTokenLen](const char* const sig) -> size_t
+        Iterator end() const
         {
-            const char* pos = sig;
-            size_t bytes = 0;
-
-            const auto isHexChar = [](const char ch) -> bool
-            {
-                return ((ch >= '0') && (ch <= '9')) || ((ch >= 'A') && (ch <= 'F')) || ((ch >= 'a') && (ch <= 'f'));
-            };
+            return Iterator{ this, nullptr };
+        }
 
-            while (*(pos = skipSpace(pos)) != '\0')
+        // Calls the visitor for each match: bool visitor(const void* found) returns false to stop, void visitor(const void* found) visits all matches.
+        // Returns the count of visited matches:
+        template <typename Visitor>
+        size_t visit(Visitor&& visitor) const
+        {
+            size_t count = 0;
+            for (const void* found = first(); found; found = next(found))
             {
-                ++bytes;
-                const size_t entryLen = calcTokenLen(pos);
-                constexpr auto k_maxTokenSize = (sizeof("xx") - sizeof('\0'));
-                if (entryLen > k_maxTokenSize)
-                {
-                    return 0;
-                }
-
-                if (entryLen == k_maxTokenSize)
+                ++count;
+                if constexpr (std::is_void_v<decltype(visitor(found))>)
                 {
-                    if ((pos[0] == '?') || (pos[1] == '?'))
-                    {
-                        if (pos[0] != pos[1])
-                        {
-                            return 0;
-                        }
-                    }
-                    else
-                    {
-                        if (!isHexChar(pos[0]) || !isHexChar(pos[1]))
-                        {
-                            return 0;
-                        }
-                    }
+                    visitor(found);
                 }
-                else if (entryLen == sizeof('x'))
+                else
                 {
-                    if ((pos[0] != '?') && !isHexChar(pos[0]))
+                    if (!visitor(found))
                     {
-                        return 0;
+                        break;
                     }
                 }
-
-                pos += entryLen;
             }
 
-            return bytes;
-        };
-
-        const auto testPattern = [&skipSpace, &calcTokenLen](const void* const buf, const char* const sig) -> bool
-        {
-            const char* sigPos = sig;
-            const unsigned char* bufPos = static_cast<const unsigned char*>(buf);
+            return count;
+        }
+    };
 
-            const auto tokenToByte = [](const char* const token, size_t size) -> unsigned char
-            {
-                const auto charToByte = [](const char ch) -> unsigned char
-                {
-                    if (ch >= '0' && ch <= '9')
-                    {
-                        return static_cast<unsigned char>(ch - '0');
-                    }
+    // Pattern format in a template way: Sig::findAll<Sig::Byte<0x11, 0x22>, Sig::Dword<>>(buf, size)
+    template <typename... Entries>
+    static Matches<TemplateSearcher<Entries...>> findAll(const void* const buf, const size_t size, const Overlap overlap = Overlap::allowed)
+    {
+        return Matches<TemplateSearcher<Entries...>>{ TemplateSearcher<Entries...>{}, buf, size, overlap };
+    }
 
-                    if (ch >= 'A' && ch <= 'F')
-                    {
-                        return static_cast<unsigned char>(ch - 'A' + 10);
-                    }
+    // Pattern format: "\x11\x2\x00text" + "..?...."
+    template <typename... Comparators>
+    static Matches<MaskSearcher<Comparators...>> findAll(const void* const buf, const size_t size, const char* const sig, const char* const mask, const size_t sigsize, const Overlap overlap = Overlap::allowed)
+    {
+        return Matches<MaskSearcher<Comparators...>>{ MaskSearcher<Comparators...>{ sig, nullptr, mask, sigsize }, buf, size, overlap };
+    }
 
-                    if (ch >= 'a' && ch <= 'f')
-                    {
-                        return static_cast<unsigned char>(ch - 'a' + 10);
-                    }
+    // Pattern format: "\x11\x2\x00text" + "..?...."
+    template <typename... Comparators>
+    static Matches<MaskSearcher<Comparators...>> findAll(const void* const buf, const size_t size, const char* const sig, const char* const mask, const Overlap overlap = Overlap::allowed)
+    {
+        return findAll<Comparators...>(buf, size, sig, mask, mask ? strlen(mask) : 0, overlap);
+    }
 
-                    return 0;
-                };
+    // Pattern format: "\x11\x2\x00text" + nullptr/"....\x1C\x03." + "..?.mm."
+    template <typename... Comparators>
+    static Matches<MaskSearcher<Comparators...>> findAll(const void* const buf, const size_t size, const char* const sig, const char* const subsig, const char* const mask, const size_t sigsize, const Overlap overlap = Overlap::allowed)
+    {
+        return Matches<MaskSearcher<Comparators...>>{ MaskSearcher<Comparators...>{ sig, subsig, mask, sigsize }, buf, size, overlap };
+    }
 
-                if (size == 2)
-                {
-                    return (charToByte(token[0]) << 4) | (charToByte(token[1]));
-                }
-                else if (size == 1)
-                {
-                    return charToByte(token[0]);
-                }
-                else
-                {
-                    return 0;
-                }
-            };
+    // Pattern format: "\x11\x2\x00text" + "....\x1C\x03." + "..?.mm."
+    template <typename... Comparators>
+    static Matches<MaskSearcher<Comparators...>> findAll(const void* const buf, const size_t size, const char* const sig, const char* const subsig, const char* const mask, const Overlap overlap = Overlap::allowed)
+    {
+        return findAll<Comparators...>(buf, size, sig, subsig, mask, mask ? strlen(mask) : 0, overlap);
+    }
 
-            while (*(sigPos = skipSpace(sigPos)) != '\0')
-            {
-                const size_t tokenSize = calcTokenLen(sigPos);
+    // Pattern format: compiled pattern (Sig::Pattern, Sig::FixedPattern<capacity> or Sig::PatternView), the pattern must outlive the range
+    static Matches<PatternView> findAll(const void* const buf, const size_t size, const PatternView& pattern, const Overlap overlap = Overlap::allowed)
+    {
+        return Matches<PatternView>{ pattern, buf, size, overlap };
+    }
 
-                if ((*sigPos) == '?')
-                {
-                    sigPos += tokenSize;
-                    ++bufPos;
-                    continue;
-                }
+    // Pattern format: "11 22 ? 44 ?? ?? 66 aa bB Cc DD ee FF", compiled once into the range,
+    // patterns longer than Sig::k_inlinePatternCapacity bytes must be compiled into the Sig::Pattern first
+    static Matches<FixedPattern<k_inlinePatternCapacity>> findAll(const void* const buf, const size_t size, const char* const sig, const Overlap overlap = Overlap::allowed)
+    {
+        return Matches<FixedPattern<k_inlinePatternCapacity>>{ FixedPattern<k_inlinePatternCapacity>(sig), buf, size, overlap };
+    }
 
-                const auto tokenByte = tokenToByte(sigPos, tokenSize);
-                if (*bufPos != tokenByte)
-                {
-                    return false;
-                }
+    // Pattern format: sig ("\x0D\xCB\xFF") + valuable bits in the sig that must match ("\x0D\xFF\x03")
+    static Matches<PatternView> bitmaskAll(const void* const buf, const size_t size, const void* const sig, const void* const mask, const size_t sigsize, const Overlap overlap = Overlap::allowed)
+    {
+        const PatternView pattern{ static_cast<const unsigned char*>(sig), static_cast<const unsigned char*>(mask), (sig && mask) ? sigsize : 0 };
+        return Matches<PatternView>{ pattern, buf, size, overlap };
+    }
 
-                sigPos += tokenSize;
-                ++bufPos;
-            }
 
-            return true;
-        };
 
-        const size_t sigBytes = calcSigBytes(sig);
-        if (!sigBytes)
+    // Converts the pattern + mask (or pattern + subpattern + mask) into the value/mask form,
+    // fails if the mask has chars other than Sig::Mask::Eq, Sig::Mask::Any or Sig::Mask::BitMask (that requires the subpattern):
+    template <typename... Comparators>
+    static bool lowerMask(
+        const char* const sig,
+        const char* const subsig,
+        const char* const mask,
+        const size_t sigsize,
+        unsigned char* const val,
+        unsigned char* const msk
+    )
+    {
+        if (!sig || !mask)
         {
-            return nullptr;
+            return false;
         }
 
-        const auto* pos = static_cast<const unsigned char*>(buf);
-        const auto* const end = static_cast<const unsigned char*>(buf) + size - sigBytes + 1;
-
-        while (pos < end)
+        for (size_t i = 0; i < sigsize; ++i)
         {
-            const bool matches = testPattern(pos, sig);
-            if (matches)
+            switch (MaskComparator<Comparators...>::lowering(mask[i]))
             {
-                return pos;
+            case Mask::Lowering::exact:
+            {
+                val[i] = static_cast<unsigned char>(sig[i]);
+                msk[i] = 0xFF;
+                break;
+            }
+            case Mask::Lowering::any:
+            {
+                val[i] = 0x00;
+                msk[i] = 0x00;
+                break;
+            }
+            case Mask::Lowering::bits:
+            {
+                if (!subsig)
+                {
+                    return false;
+                }
+
+                msk[i] = static_cast<unsigned char>(subsig[i]);
+                val[i] = static_cast<unsigned char>(sig[i]) & msk[i];
+                break;
+            }
+            default:
+            {
+                return false;
+            }
             }
-            ++pos;
         }
 
-        return nullptr;
+        return true;
     }
+
+    // Frequencies of bytes in x86-64 code: occurrences per 65536 bytes of .text sections of a typical Linux distribution:
+    struct X64Frequency
+    {
+        static constexpr unsigned short k_table[256]
+        {
+            /* 0_ */ 8320, 1203,  443,  324,  489,  330,  151,  166,  728,  124,   93,  109,  157,  115,   70, 2246,
+            /* 1_ */  631,  181,   65,   57,  129,  189,   64,   54,  325,   49,   43,   42,   84,   58,   48,  478,
+            /* 2_ */  346,   76,   43,   38, 1930,  130,   34,   38,  300,  185,   37,   73,   74,   58,  138,   42,
+            /* 3_ */  226,  419,   34,   46,   77,  122,   34,   45,  194,  342,   43,  106,  119,  136,   42,   57,
+            /* 4_ */  450,  995,   83,  158,  879,  350,   89,  116, 4804,  774,   62,   59, 1154,  265,   51,   54,
+            /* 5_ */  225,   43,   40,  152,  226,  189,   99,  104,  125,   37,   35,  157,  178,  201,  106,   97,
+            /* 6_ */  138,   54,  157,   79,  128,   51,  751,   43,  109,   47,   40,   53,  113,   52,   60,  167,
+            /* 7_ */  182,   37,   87,   85,  585,  302,   59,   74,  122,   41,   36,   78,  225,  114,  108,  122,
+            /* 8_ */  282,  141,   48,  872,  839,  783,   50,   70,  141, 2600,   42, 1901,   83, 1017,   41,   39,
+            /* 9_ */  198,   29,   30,   34,   95,   55,   27,   29,   77,   32,   23,   24,   54,   33,   24,   27,
+            /* A_ */   87,   56,   26,   31,   40,   28,   24,   25,   78,   27,   36,   31,   58,   27,   23,   44,
+            /* B_ */   93,   44,   24,   31,   76,   44,  135,   89,  159,  103,  162,   52,  132,   73,  171,  106,
+            /* C_ */  644,  360,  152,  333,  239,  225,  231,  428,  147,  144,   74,   47,   61,   51,   59,   54,
+            /* D_ */  157,   94,  152,   75,   55,   64,   70,   64,  145,   78,   69,  115,   48,   66,   92,  196,
+            /* E_ */  183,  115,  108,   71,   78,   75,   96,  130, 1111,  453,   98,  268,  133,  125,  131,  219,
+            /* F_ */  170,   76,  113,  155,   61,  129,  244,  187,  238,  133,  150,  142,  147,  258,  462, 3011,
+        };
+    };
+
+    // Single-pass engine for many runtime patterns, defined in <Sig/PatternSet.hpp>:
+    struct PatternSet;
+
+    // Multi-threaded chunked scanning, defined in <Sig/Parallel.hpp>:
+    struct Parallel;
+
+    // Scanning of data that arrives in chunks, defined in <Sig/Stream.hpp>:
+    template <typename Searcher>
+    struct Stream;
+
+    // Memory-mapped file scanning, defined in <Sig/File.hpp>:
+    struct File;
+
+    // Live process memory scanning on Linux, defined in <Sig/Process.hpp>:
+    struct Process;
+
+    // Section and segment-aware scanning of ELF binaries and core dumps, defined in <Sig/Elf.hpp>:
+    struct Elf;
+
+    // Hardware counters of the scans for Sig::Stats on Linux, defined in <Sig/Perf.hpp>:
+    struct Perf;
+
+    // Persisted results of scans of unchanged images, defined in <Sig/Cache.hpp>:
+    struct Cache;
 };
 
 template <>
@@ -1137,6 +4452,24 @@ struct Sig::MaskComparator<>
     {
         return false;
     }
+
+    static Mask::Lowering lowering(const char)
+    {
+        return Mask::Lowering::none;
+    }
 };
 
-#undef sig_has_cxx20
\ No newline at end of file
+#undef sig_has_cxx20
+#undef sig_has_x86
+#undef sig_has_neon
+#undef sig_has_dispatch
+#undef sig_has_sse2
+#undef sig_has_avx2
+#undef sig_has_avx512
+#undef sig_target
+#undef sig_flatten
+#undef sig_stats
+
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Sig.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+// Finds all matches in data that arrives in chunks: only the last patternSize - 1 bytes are kept between chunks,
+// so the memory doesn't depend on the size of the input. Matches are reported by their absolute offsets in the stream.
+// Chunks are scanned in place, only the junction of the kept bytes and the next chunk is copied.
+//
+//   Sig::Stream stream(Sig::Pattern("11 22 ? 44"));
+//   stream.feed(chunk, chunkSize, [](unsigned long long offset) { ... });
+//   ...
+//   stream.finish();
+template <typename Searcher>
+struct Sig::Stream
+{
+    explicit Stream(Searcher searcher) : m_searcher(std::move(searcher)), m_keep(m_searcher.patternSize() ? (m_searcher.patternSize() - 1) : 0)
+    {
+        m_tail.reserve(m_keep);
+        m_junction.reserve(m_keep * 2);
+    }
+
+    // Scans the next chunk: bool visitor(unsigned long long offset) returns false to stop the stream,
+    // void visitor(unsigned long long offset) visits all matches.
+    // Returns the count of visited matches:
+    template <typename Visitor>
+    size_t feed(const void* const data, const size_t size, Visitor&& visitor)
+    {
+        if (m_stopped || !size)
+        {
+            return 0;
+        }
+
+        const auto* const chunk = static_cast<const unsigned char*>(data);
+
+        // Matches that start in the kept bytes and end in the chunk:
+        size_t count = 0;
+        if (!m_tail.empty())
+        {
+            const size_t head = (size < m_keep) ? size : m_keep;
+            m_junction.assign(m_tail.begin(), m_tail.end());
+            m_junction.insert(m_junction.end(), chunk, chunk + head);
+
+            count += scan(m_junction.data(), m_junction.size(), m_offset - m_tail.size(), visitor);
+        }
+
+        // Matches that lie entirely in the chunk:
+        if (!m_stopped && (size > m_keep))
+        {
+            count += scan(chunk, size, m_offset, visitor);
+        }
+
+        keep(chunk, size);
+        m_offset += size;
+        m_matches += count;
+        return count;
+    }
+
+    // Ends the stream: the kept bytes can't hold a match as every searcher needs patternSize bytes.
+    // Returns the count of matches in the whole stream:
+    size_t finish()
+    {
+        const size_t matches = m_matches;
+        reset();
+        return matches;
+    }
+
+    // Starts a new stream with the same pattern:
+    void reset()
+    {
+        m_tail.clear();
+        m_offset = 0;
+        m_matches = 0;
+        m_stopped = false;
+    }
+
+    // Count of fed bytes:
+    unsigned long long offset() const
+    {
+        return m_offset;
+    }
+
+    bool stopped() const
+    {
+        return m_stopped;
+    }
+
+    const Searcher& searcher() const
+    {
+        return m_searcher;
+    }
+
+private:
+    // Reports matches at the positions that have at least patternSize bytes in the buffer,
+    // the rest positions are scanned again when the next chunk arrives:
+    template <typename Visitor>
+    size_t scan(const unsigned char* const buf, const size_t size, const unsigned long long base, Visitor&& visitor)
+    {
+        if (size <= m_keep)
+        {
+            return 0;
+        }
+
+        const size_t last = size - m_keep - 1;
+
+        size_t count = 0;
+        for (size_t pos = 0; pos <= last; ++pos)
+        {
+            const void* const found = m_searcher.find(buf + pos, size - pos);
+            if (!found)
+            {
+                break;
+            }
+
+            pos = static_cast<size_t>(static_cast<const unsigned char*>(found) - buf);
+            if (pos > last)
+            {
+                break;
+            }
+
+            ++count;
+            if constexpr (std::is_void_v<decltype(visitor(base + pos))>)
+            {
+                visitor(base + pos);
+            }
+            else
+            {
+                if (!visitor(base + pos))
+                {
+                    m_stopped = true;
+                    break;
+                }
+            }
+        }
+
+        return count;
+    }
+
+    // Keeps the last patternSize - 1 bytes of the stream:
+    void keep(const unsigned char* const chunk, const size_t size)
+    {
+        if (size >= m_keep)
+        {
+            m_tail.assign(chunk + size - m_keep, chunk + size);
+            return;
+        }
+
+        const size_t total = m_tail.size() + size;
+        if (total > m_keep)
+        {
+            m_tail.erase(m_tail.begin(), m_tail.begin() + static_cast<std::ptrdiff_t>(total - m_keep));
+        }
+
+        m_tail.insert(m_tail.end(), chunk, chunk + size);
+    }
+
+    Searcher m_searcher;
+    size_t m_keep;
+    std::vector<unsigned char> m_tail;
+    std::vector<unsigned char> m_junction;
+    unsigned long long m_offset = 0;
+    size_t m_matches = 0;
+    bool m_stopped = false;
+};